@@ -15,10 +15,21 @@
 			
   			include "init.inc"
 			include "outhex.inc"
+			include "parse.inc"
 	
 BUFSIZE:		equ    4096
 
+; Offsets in the FatFS FILINFO structure (see mos_api.inc)
+FILINFO_fattrib:	equ    8
+FILINFO_fname:		equ    22
+FILINFO_SIZE:		equ    278
+
 ; File compare utility. Compares two files and shows byte offset of any difference. 
+; Options: -l lists every differing byte, -c only counts them,
+; -n <limit> stops after that many differences.
+; Checksum options: -s <file> shows the CRC32 and size of a file,
+; -w <manifest> writes a manifest with name, CRC32 and size of all files in the
+; current directory, -v <manifest> verifies the files listed in a manifest.
 ;
 ; The main routine
 ; IXU: argv - pointer to array of parameters
@@ -26,10 +37,77 @@ BUFSIZE:		equ    4096
 ; Returns:
 ;  HL: Error code, or 0 if OK
 ;
-_main:			LD	A, C
+_main:			XOR	A
+			LD	(Mode), A
+			LD	HL, 0
+			LD	(Limit), HL
+			LD	(Diff_Count), HL
+main_opts:		LD	A, C
 			CP 	#3
-			JR  	Z, main1
-			LD 	HL, s_USAGE		; Number of args != 2, print usage string and exit
+			JP	C, main_usage
+			LD	HL, (IX+3)		; Next parameter, is it an option?
+			LD	A, (HL)
+			CP	'-'
+			JP	NZ, main_files
+			INC	HL
+			LD	E, (HL)			; Option letter
+			INC	HL
+			LD	A, (HL)
+			OR	A
+			JP	NZ, main_usage		; Options are a single letter.
+			LD	A, E
+			CP	'l'
+			JR	Z, main_opt_list
+			CP	'c'
+			JR	Z, main_opt_count
+			CP	's'
+			JR	Z, main_opt_crc
+			CP	'w'
+			JR	Z, main_opt_crc
+			CP	'v'
+			JR	Z, main_opt_crc
+			CP	'n'
+			JP	NZ, main_usage
+			LD	A, C
+			CP	#5
+			JP	C, main_usage		; Need limit and two file names.
+			LD	HL, (IX+6)
+			CALL	ASC_TO_NUMBER
+			JP	NC, main_usage
+			LD	(Limit), DE
+			LD	A, (Mode)
+			OR	A
+			JR	NZ, @F
+			INC	A			; A limit implies -l when no mode given.
+			LD	(Mode), A
+@@:			LEA	IX, IX+6
+			DEC	C
+			DEC	C
+			JR	main_opts
+main_opt_list:		LD	A, 1
+			JR	@F
+main_opt_count:		LD	A, 2
+@@:			LD	(Mode), A
+			LEA	IX, IX+3
+			DEC	C
+			JR	main_opts
+main_opt_crc:		LD	A, C
+			CP	#3
+			JP	NZ, main_usage		; Option and a single file name only.
+			PUSH	DE			; Keep option letter in E.
+			CALL	crc_init
+			POP	DE
+			LD	HL, (IX+6)
+			LD	A, E
+			CP	'w'
+			JP	Z, manifest_write
+			CP	'v'
+			JP	Z, manifest_verify
+			JP	crc_show
+main_files:		LD	A, C
+			CP	#3
+			JR	Z, main1		; Exactly two file names.
+main_usage:		LD 	HL, s_USAGE		; Number of args != 2, print usage string and exit
 			CALL	Print_String
 			LD	HL, 19
 			RET
@@ -101,26 +179,37 @@ main_comp_loop:		POP 	DE
 			JR	Z, main_same_size
 			JR	NC, main_file1_larger
 main_file2_larger:	LD	BC, (Blk1_Size)
-			CALL	comp_blocks
+			CALL	compare
 			JR 	NZ, main_blocks_differ    
 			LD	DE, (IX+6)
 			JP 	main_size_differ
 main_file1_larger:	LD	BC, (Blk2_Size)
-			CALL	comp_blocks
+			CALL	compare
 			JR 	NZ, main_blocks_differ    
 			LD	DE, (IX+3)
 			JP 	main_size_differ	
 main_same_size:		LD	BC, (Blk1_Size)
-			CALL	comp_blocks
+			CALL	compare
 			JR	NZ, main_blocks_differ
 			LD	A, (At_End)		
 			AND	A
 			JP	Z, main_comp_loop
-main_file_same:		LD	HL, s_SAME
+main_file_same:		LD	A, (Mode)
+			AND	A
+			JR	Z, @F
+			LD	HL, (Diff_Count)
+			LD	BC, 0
+			AND	A
+			SBC	HL, BC
+			JR	NZ, main_summary	; Differences were listed or counted.
+@@:			LD	HL, s_SAME
 			CALL	Print_String
 			LD	HL, 0
 			JR 	main_close_all
-main_blocks_differ:	LD	HL, s_DIFFER
+main_blocks_differ:	LD	A, (Mode)
+			AND	A
+			JR	NZ, main_summary	; Limit reached
+			LD	HL, s_DIFFER
 			CALL	Print_String
 			LD	HL, (File_Offs)
 			CALL	Print_Hex24
@@ -133,6 +222,15 @@ main_size_differ:	LD	HL, s_LARGER
 			CALL	Print_String
 			LD 	HL, s_CRLF
 			CALL	Print_String
+			LD	A, (Mode)
+			AND	A
+			JR	Z, main_close_all
+main_summary:		LD	HL, s_COUNT
+			CALL	Print_String
+			LD	HL, (Diff_Count)
+			CALL	Print_Hex24
+			LD 	HL, s_CRLF
+			CALL	Print_String
 main_close_all:		POP DE
 			LD C, E
 			MOSCALL mos_fclose
@@ -141,6 +239,17 @@ main_close_all:		POP DE
 			LD HL, 0
 			RET
 
+; compare
+;
+; Compare the blocks in Buf1 and Buf2 the way selected by the options.
+;
+; input 	BC is number of bytes to compare.
+; output	Z flag is set to continue with the next block, cleared to stop.
+compare:		LD	A, (Mode)
+			AND	A
+			JR	Z, comp_blocks		; Stop at the first difference.
+			JR	diff_blocks
+
 ; read_block
 ;
 ; Read blcok from open file
@@ -159,23 +268,66 @@ read_block:		PUSH 	DE			; Store original max size
 ; comp_blocks.
 ;
 ; Compare blocks in Buf1 and Buf2. Adjust File_Offs for number of bytes compared.
+; Uses CPI, which compares, advances HL and counts down BC in one instruction,
+; so the loop needs no separate test for the end of the block.
 ;
 ; input 	BC is number of bytes to compare.
 ; output	Z flag is set when blocks are equal, cleared otherwise.
 			
 comp_blocks:		LD	HL, Buf1			
 			LD	DE, Buf2
-			JR	comp2
+			LD	A, B			; We are equal if block length = 0.
+			OR	C
+			JR	Z, comp_end
 comp1:			LD 	A, (DE)
-			CP	(HL)
+			INC 	DE
+			CPI				; Compare with (HL), HL++, BC--
 			JR	NZ, comp_ne
-			INC	HL
+			JP	PE, comp1		; Loop while BC not zero.
+			JR	comp_end		; Z is still set, blocks are equal.
+comp_ne:		DEC	HL			; Point to the differing byte, flags unchanged.
+comp_end:		PUSH	AF			; Keep zero flag to return.
+			AND 	A
+			LD	DE, Buf1
+			SBC	HL, DE 
+			LD	DE, (File_Offs)
+			ADD	HL, DE
+			LD	(File_Offs), HL		; Add compared bytes to offset.
+			POP 	AF
+			RET
+			
+; diff_blocks.
+;
+; Compare blocks in Buf1 and Buf2 completely and count every differing byte,
+; in list mode also print it. Adjust File_Offs for number of bytes compared.
+;
+; input 	BC is number of bytes to compare.
+; output	Z flag is set when the limit was not reached, cleared otherwise.
+
+diff_blocks:		LD	HL, Buf1			
+			LD	DE, Buf2
+			LD	A, B			; Nothing to do if block length = 0.
+			OR	C
+			JR	Z, diff_end
+diff1:			LD 	A, (DE)
 			INC 	DE
-			DEC     BC
-comp2:			LD	A, B			; We are equal if block length = 0.
+			CPI				; Compare with (HL), HL++, BC--
+			JR	NZ, diff_found
+			JP	PE, diff1		; Loop while BC not zero.
+			JR	diff_end
+diff_found:		PUSH	BC
+			PUSH	DE
+			PUSH	HL
+			CALL	report_diff
+			POP	HL
+			POP	DE
+			POP	BC
+			JR	NZ, diff_stop		; Limit reached.
+			LD	A, B			; BC is at most BUFSIZE, 16 bits suffice.
 			OR	C
-			JR	NZ, comp1
-comp_ne:		PUSH	AF			; Keep zero flag to return.
+			JR	NZ, diff1
+diff_end:		XOR	A			; Set zero flag, continue.
+diff_stop:		PUSH	AF			; Keep zero flag to return.
 			AND 	A
 			LD	DE, Buf1
 			SBC	HL, DE 
@@ -184,13 +336,551 @@ comp_ne:		PUSH	AF			; Keep zero flag to return.
 			LD	(File_Offs), HL		; Add compared bytes to offset.
 			POP 	AF
 			RET
-			
+
+; report_diff
+;
+; Count a differing byte, print its offset and both values in list mode.
+;
+; input		HL, DE point just after the differing bytes in Buf1, Buf2.
+; output	Z flag is set when the limit was not reached, cleared otherwise.
+;		Destroys all registers except IX.
+report_diff:		DEC	HL
+			DEC	DE
+			LD	A, (Mode)
+			CP	1
+			JR	NZ, report_count
+			PUSH	DE
+			PUSH	HL
+			LD	DE, Buf1
+			AND 	A
+			SBC	HL, DE
+			LD	DE, (File_Offs)
+			ADD	HL, DE
+			CALL	Print_Hex24		; Offset of the difference.
+			LD	A, ' '
+			RST.LIL	10h
+			POP	HL
+			LD	A, (HL)
+			CALL	Print_Hex8		; Byte in file1.
+			LD	A, ' '
+			RST.LIL	10h
+			POP	DE
+			LD	A, (DE)
+			CALL	Print_Hex8		; Byte in file2.
+			LD 	HL, s_CRLF
+			CALL	Print_String
+report_count:		LD	HL, (Diff_Count)
+			INC	HL
+			LD	(Diff_Count), HL
+			EX	DE, HL
+			LD	HL, (Limit)
+			LD	BC, 0
+			AND	A
+			SBC	HL, BC
+			RET	Z			; No limit given.
+			SBC	HL, DE			; Carry is clear here.
+			JR	Z, @F
+			XOR	A			; Below the limit, set zero flag.
+			RET
+@@:			INC	A			; Limit reached, A is not $ff, clear zero flag.
+			RET
+
+; crc_init
+;
+; Build the CRC32 lookup table. Entry n is stored as four bytes, least
+; significant byte in Crc_T0+n up to most significant in Crc_T3+n,
+; so an entry can be found by loading the index into L.
+crc_init:		LD	HL, Crc_T0
+crc_init1:		LD	E, L			; BCDE is the CRC value, start with index.
+			LD	D, 0
+			LD	C, 0
+			LD	B, 0
+			LD	A, 8
+crc_init2:		SRL	B			; Shift right one bit
+			RR	C
+			RR	D
+			RR	E
+			JR	NC, crc_init3
+			PUSH	AF
+			LD	A, B			; XOR with the reversed polynomial $EDB88320
+			XOR	$ED
+			LD	B, A
+			LD	A, C
+			XOR	$B8
+			LD	C, A
+			LD	A, D
+			XOR	$83
+			LD	D, A
+			LD	A, E
+			XOR	$20
+			LD	E, A
+			POP	AF
+crc_init3:		DEC	A
+			JR	NZ, crc_init2
+			LD	(HL), E
+			INC	H
+			LD	(HL), D
+			INC	H
+			LD	(HL), C
+			INC	H
+			LD	(HL), B
+			DEC	H
+			DEC	H
+			DEC	H
+			INC	L
+			JR	NZ, crc_init1
+			RET
+
+; crc_block
+;
+; Add a block of bytes to the CRC32 in Crc.
+;
+; input:	HL = buffer position.
+;		BC = nof bytes (less than 0x10000).
+crc_block:		LD	A, B
+			OR	C
+			RET	Z
+			LD	(Crc_Left), BC
+			PUSH	HL
+			POP	IY
+			LD	HL, Crc			; Keep CRC in BCDE during the loop.
+			LD	E, (HL)
+			INC	HL
+			LD	D, (HL)
+			INC	HL
+			LD	C, (HL)
+			INC	HL
+			LD	B, (HL)
+crc_block1:		LD	A, (IY+0)
+			INC	IY
+			XOR	E			; Table index is low byte of CRC XOR data.
+			LD	HL, Crc_T0
+			LD	L, A
+			LD	A, (HL)			; CRC = (CRC >> 8) XOR table entry.
+			XOR	D
+			LD	E, A
+			INC	H
+			LD	A, (HL)
+			XOR	C
+			LD	D, A
+			INC	H
+			LD	A, (HL)
+			XOR	B
+			LD	C, A
+			INC	H
+			LD	B, (HL)
+			LD	HL, (Crc_Left)
+			DEC	HL
+			LD	(Crc_Left), HL
+			LD	A, H
+			OR	L
+			JR	NZ, crc_block1
+			LD	HL, Crc
+			LD	(HL), E
+			INC	HL
+			LD	(HL), D
+			INC	HL
+			LD	(HL), C
+			INC	HL
+			LD	(HL), B
+			RET
+
+; crc_file
+;
+; Compute CRC32 and size of a file in one pass.
+;
+; input:	HL = file name.
+; output:	Carry set if the file could not be opened,
+;		otherwise Crc and File_Size hold the result.
+crc_file:		LD	C, fa_read
+			MOSCALL mos_fopen
+			OR	A
+			SCF
+			RET	Z
+			LD	(Crc_Handle), A
+			LD	HL, Crc			; CRC starts as $FFFFFFFF, size as 0.
+			LD	B, 4
+@@:			LD	(HL), $FF
+			INC	HL
+			DJNZ	@B
+			LD	B, 4
+@@:			LD	(HL), 0			; File_Size follows Crc
+			INC	HL
+			DJNZ	@B
+crc_file1:		LD	A, (Crc_Handle)
+			LD	C, A
+			LD	HL, Buf1
+			LD	DE, BUFSIZE
+			CALL	read_block
+			PUSH	HL
+			LD	DE, (File_Size)		; Add block size to 32-bit size.
+			ADD	HL, DE
+			LD	(File_Size), HL
+			JR	NC, @F
+			LD	A, (File_Size+3)
+			INC	A
+			LD	(File_Size+3), A
+@@:			POP	BC
+			PUSH	BC
+			LD	HL, Buf1
+			CALL	crc_block
+			POP	HL
+			LD	DE, BUFSIZE
+			AND	A
+			SBC	HL, DE
+			JR	Z, crc_file1		; Full block read, not yet at end of file.
+			LD	A, (Crc_Handle)
+			LD	C, A
+			MOSCALL mos_fclose
+			LD	HL, Crc			; Final CRC is inverted.
+			LD	B, 4
+@@:			LD	A, (HL)
+			CPL
+			LD	(HL), A
+			INC	HL
+			DJNZ	@B
+			AND	A			; Clear carry, success.
+			RET
+
+; crc_show
+;
+; Show name, CRC32 and size of a single file.
+;
+; input:	HL = file name.
+crc_show:		PUSH	HL
+			CALL	crc_file
+			POP	HL
+			JR	C, crc_open_error
+			CALL	fmt_line
+			LD	HL, Line_Buf
+			CALL	Print_String
+			LD	HL, 0
+			RET
+crc_open_error:		PUSH	HL
+			LD	HL, s_ERROR_OPEN
+			CALL	Print_String
+			POP	HL
+			CALL	Print_String
+			LD	HL, s_CRLF
+			CALL	Print_String
+			LD	HL, 4
+			RET
+
+; manifest_write
+;
+; Write a manifest line for every file in the current directory.
+;
+; input:	HL = manifest file name.
+manifest_write:		LD	(Man_Name), HL
+			LD	C, fa_write + fa_create_always
+			MOSCALL mos_fopen
+			OR	A
+			JR	NZ, @F
+			LD	HL, (Man_Name)
+			JR	crc_open_error
+@@:			LD	(Man_Handle), A
+			LD	HL, Dir_Struct
+			LD	DE, s_CURDIR
+			MOSCALL ffs_dopen
+			OR	A
+			JR	NZ, manifest_write_end
+manifest_write1:	LD	HL, Dir_Struct
+			LD	DE, File_Info
+			MOSCALL ffs_dread
+			OR	A
+			JR	NZ, manifest_write2
+			LD	A, (File_Info+FILINFO_fname)
+			OR	A
+			JR	Z, manifest_write2	; End of directory
+			LD	A, (File_Info+FILINFO_fattrib)
+			AND	$10
+			JR	NZ, manifest_write1	; Skip subdirectories
+			LD	HL, File_Info+FILINFO_fname
+			LD	DE, (Man_Name)
+			CALL	str_case_equal
+			JR	Z, manifest_write1	; Skip the manifest itself
+			LD	HL, File_Info+FILINFO_fname
+			CALL	crc_file
+			JR	C, manifest_write1
+			LD	HL, File_Info+FILINFO_fname
+			CALL	fmt_line
+			EX	DE, HL			; DE = line length
+			LD	HL, Line_Buf
+			LD	A, (Man_Handle)
+			LD	C, A
+			MOSCALL mos_fwrite
+			JR	manifest_write1
+manifest_write2:	LD	HL, Dir_Struct
+			MOSCALL ffs_dclose
+manifest_write_end:	LD	A, (Man_Handle)
+			LD	C, A
+			MOSCALL mos_fclose
+			LD	HL, 0
+			RET
+
+; manifest_verify
+;
+; Check every file listed in a manifest against its CRC32 and size.
+;
+; input:	HL = manifest file name.
+manifest_verify:	PUSH	HL
+			LD	C, fa_read
+			MOSCALL mos_fopen
+			POP	HL
+			OR	A
+			JP	Z, crc_open_error
+			LD	(Man_Handle), A
+			LD	HL, 0
+			LD	(Checked), HL
+			LD	(Failed), HL
+manifest_verify1:	CALL	read_line
+			JP	C, manifest_verify_end
+			CP	19
+			JR	C, manifest_verify1	; Too short for name, CRC and size.
+			LD	HL, Line_Buf
+			LD	DE, 0
+			LD	E, A
+			ADD	HL, DE
+			LD	DE, -18
+			ADD	HL, DE			; Point to space before CRC.
+			LD	A, (HL)
+			CP	' '
+			JR	NZ, manifest_verify1
+			LD	(HL), 0			; Terminate file name.
+			INC	HL
+			LD	DE, Exp_Crc
+			CALL	parse_hex32
+			JR	C, manifest_verify1
+			INC	HL			; Skip space before size.
+			LD	DE, Exp_Size
+			CALL	parse_hex32
+			JR	C, manifest_verify1
+			LD	HL, (Checked)
+			INC	HL
+			LD	(Checked), HL
+			LD	HL, Line_Buf
+			CALL	crc_file
+			LD	HL, s_MISSING
+			JR	C, manifest_verify3
+			LD	HL, Crc			; Compare CRC and size (8 bytes).
+			LD	DE, Exp_Crc
+			LD	B, 8
+manifest_verify2:	LD	A, (DE)
+			CP	(HL)
+			JR	NZ, @F
+			INC	HL
+			INC	DE
+			DJNZ	manifest_verify2
+			JP	manifest_verify1	; File is OK
+@@:			LD	HL, s_CHANGED
+manifest_verify3:	PUSH	HL
+			LD	HL, Line_Buf
+			CALL	Print_String
+			POP	HL
+			CALL	Print_String
+			LD	HL, (Failed)
+			INC	HL
+			LD	(Failed), HL
+			JP	manifest_verify1
+manifest_verify_end:	LD	A, (Man_Handle)
+			LD	C, A
+			MOSCALL mos_fclose
+			LD	HL, s_CHECKED
+			CALL	Print_String
+			LD	HL, (Checked)
+			CALL	Print_Hex24
+			LD	HL, s_FAILED
+			CALL	Print_String
+			LD	HL, (Failed)
+			CALL	Print_Hex24
+			LD	HL, s_CRLF
+			CALL	Print_String
+			LD	HL, 0
+			RET
+
+; read_line
+;
+; Read a line from the manifest into Line_Buf, without CR and LF.
+; Characters beyond 255 are dropped.
+;
+; output:	A = length of the line.
+;		Carry set at end of file when nothing was read.
+read_line:		LD	DE, Line_Buf
+			LD	B, 0			; Length of line
+			LD	A, (Man_Handle)
+			LD	C, A
+read_line1:		MOSCALL mos_feof
+			CP	1
+			JR	Z, read_line_eof
+			MOSCALL mos_fgetc
+			CP	13
+			JR	Z, read_line1
+			CP	10
+			JR	Z, read_line_end
+			INC	B
+			JR	Z, @F			; Line too long, drop character.
+			LD	(DE), A
+			INC	DE
+			JR	read_line1
+@@:			DEC	B
+			JR	read_line1
+read_line_eof:		LD	A, B
+			OR	A
+			SCF
+			RET	Z
+read_line_end:		XOR	A
+			LD	(DE), A
+			LD	A, B
+			RET				; Carry is clear here.
+
+; fmt_line
+;
+; Build a manifest line in Line_Buf: name, CRC32, size, CR LF.
+;
+; input:	HL = file name.
+; output:	HL = length of the line.
+fmt_line:		LD	DE, Line_Buf
+@@:			LD	A, (HL)
+			OR	A
+			JR	Z, @F
+			LD	(DE), A
+			INC	HL
+			INC	DE
+			JR	@B
+@@:			LD	A, ' '
+			LD	(DE), A
+			INC	DE
+			LD	HL, Crc
+			CALL	fmt_hex32
+			LD	A, ' '
+			LD	(DE), A
+			INC	DE
+			LD	HL, File_Size
+			CALL	fmt_hex32
+			LD	A, 13
+			LD	(DE), A
+			INC	DE
+			LD	A, 10
+			LD	(DE), A
+			INC	DE
+			XOR	A
+			LD	(DE), A
+			EX	DE, HL
+			LD	DE, Line_Buf
+			AND	A
+			SBC	HL, DE
+			RET
+
+; fmt_hex32
+;
+; Store a 32-bit value as 8 hex digits.
+;
+; input:	HL = address of value (least significant byte first).
+;		DE = destination, advanced by 8.
+fmt_hex32:		LD	BC, 3
+			ADD	HL, BC
+			LD	B, 4
+@@:			LD	A, (HL)
+			CALL	fmt_hex8
+			DEC	HL
+			DJNZ	@B
+			RET
+
+; fmt_hex8
+;
+; Store A as two hex digits at DE, advance DE.
+fmt_hex8:		PUSH	AF
+			RRA 
+			RRA 
+			RRA 
+			RRA 
+			CALL	@F
+			POP	AF
+@@:			AND	0Fh
+			ADD	A,90h
+			DAA
+			ADC	A,40h
+			DAA
+			LD	(DE), A
+			INC	DE
+			RET
+
+; parse_hex32
+;
+; Parse 8 hex digits into a 32-bit value.
+;
+; input:	HL = text, advanced by 8.
+;		DE = address of value (least significant byte first).
+; output:	Carry set if a character is not a hex digit.
+parse_hex32:		INC	DE
+			INC	DE
+			INC	DE
+			LD	B, 4
+@@:			CALL	parse_hex_digit
+			RET	C
+			RLCA
+			RLCA
+			RLCA
+			RLCA
+			LD	C, A
+			CALL	parse_hex_digit
+			RET	C
+			OR	C
+			LD	(DE), A
+			DEC	DE
+			DJNZ	@B
+			AND	A
+			RET
+
+; Convert hex digit at HL to its value in A, advance HL. Carry set if invalid.
+parse_hex_digit:	LD	A, (HL)
+			INC	HL
+			CALL	UPPRC
+			SUB	'0'
+			RET	C
+			CP	10
+			CCF
+			RET	NC			; 0..9
+			SUB	'A'-'0'
+			RET	C
+			CP	6
+			CCF
+			RET	C
+			ADD	A, 10			; A..F
+			RET
+
+; str_case_equal
+;
+; Compare two strings, ignoring the case of letters.
+;
+; input:	HL, DE = strings.
+; output:	Z flag set if equal.
+str_case_equal:		LD	A, (DE)
+			CALL	UPPRC
+			LD	C, A
+			LD	A, (HL)
+			CALL	UPPRC
+			CP	C
+			RET	NZ
+			OR	A
+			RET	Z
+			INC	HL
+			INC	DE
+			JR	str_case_equal
+
 ; Text messages
 ;
 s_ERROR_OPEN:		DB 	" Cannot open file ", 0
-s_USAGE:		DB	" Usage: comp <file1> <file2>\r\n", 0                                 
+s_USAGE:		DB	" Usage: comp [-l] [-c] [-n <limit>] <file1> <file2>\r\n"
+			DB	"        comp -s <file> | -w <manifest> | -v <manifest>\r\n", 0                                 
 s_DIFFER:		DB	" Files differ at offset ",0
 s_LARGER:		DB	" File is larger: ",0	
+s_COUNT:		DB	" Number of differing bytes: ",0
+s_MISSING:		DB	": cannot open\r\n",0
+s_CHANGED:		DB	": changed\r\n",0
+s_CHECKED:		DB	" Files checked: ",0
+s_FAILED:		DB	", failed: ",0
+s_CURDIR:		DB	".",0
 s_SAME:			DB	" Files are identical"	
 s_CRLF:			DB 	13,10,0
 ; Variable space
@@ -198,5 +888,26 @@ File_Offs:		DS 3
 Blk1_Size:		DS 3
 Blk2_Size:		DS 3
 At_End:			DS 1
+Mode:			DS 1		; 0 = first difference, 1 = list, 2 = count
+Limit:			DS 3		; Stop after this many differences, 0 = no limit
+Diff_Count:		DS 3
+Crc:			DS 4		; Crc and File_Size must stay together,
+File_Size:		DS 4		; they are compared with Exp_Crc, Exp_Size.
+Exp_Crc:		DS 4
+Exp_Size:		DS 4
+Crc_Left:		DS 3
+Crc_Handle:		DS 1
+Man_Handle:		DS 1
+Man_Name:		DS 3
+Checked:		DS 3
+Failed:			DS 3
+Line_Buf:		DS 256
+Dir_Struct:		DS 64		; DIR structure, 64 is more than enough
+File_Info:		DS FILINFO_SIZE
+			ALIGN 256
+Crc_T0:			DS 256		; CRC32 table, one 256-byte page per byte
+Crc_T1:			DS 256
+Crc_T2:			DS 256
+Crc_T3:			DS 256
 Buf1:			DS BUFSIZE
 Buf2:			DS BUFSIZE
\ No newline at end of file
@@ -1,36 +1,245 @@
-/* find
- * search the entire file system for file names conforming to a certain pattern
+/* concat
+ * concatenate files and write them to standard output or to a file.
  */
 
+#include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <mos_api.h>
+#include "../../find/src/glob.h"
 
 
-#define BUF_SIZE 1024
+#define BUF_SIZE 4096
 unsigned char buf[BUF_SIZE];
 
-int
-main(int argc, char *argv[])
+#define OUT_BUF_SIZE 8192
+unsigned char out_buf[OUT_BUF_SIZE];
+int out_filled = 0;
+FILE *out;
+
+#define MAX_NAMES 256
+char *names[MAX_NAMES];
+int n_names;
+
+bool raw_mode = false;
+
+static int my_strcasecmp(const char *p,const char *q)
+{
+  char c1,c2;
+  for(;;) {
+    c1 = *p++;
+    c2 = *q++;
+    if (c1 >= 'a' && c1 <= 'z') c1-=0x20;
+    if (c2 >= 'a' && c2 <= 'z') c2-=0x20;
+    if (c1 != c2) return c1-c2;
+    if ((c1 | c2 ) == 0) return 0;
+ }
+}
+
+static int name_compare(const void *a, const void *b)
+{
+  const char * const *n1 = a;
+  const char * const *n2 = b;
+  return my_strcasecmp(*n1,*n2);
+}
+
+static char *my_rindex(char *s, char c)
+{
+  char *r = NULL;
+  while (*s) {
+    if (*s == c)
+      r = s;
+    s++;
+  }
+  return r;
+}
+
+static void out_flush(void)
+{
+  if (out_filled > 0) {
+    fwrite(out_buf, 1, out_filled, out);
+    out_filled = 0;
+  }
+}
+
+/* Collect output in out_buf, so the output file is written in large
+   blocks. */
+static void out_write(unsigned char *p, int nbytes)
+{
+  int n;
+  while (nbytes > 0) {
+    if (out_filled == 0 && nbytes >= OUT_BUF_SIZE) {
+      fwrite(p, 1, nbytes, out);
+      return;
+    }
+    n = OUT_BUF_SIZE - out_filled;
+    if (n > nbytes)
+      n = nbytes;
+    memcpy(out_buf + out_filled, p, n);
+    out_filled += n;
+    p += n;
+    nbytes -= n;
+    if (out_filled == OUT_BUF_SIZE)
+      out_flush();
+  }
+}
+
+/* Write a block, leaving out all CR characters. The runs between them are
+   written with one out_write each. */
+static void write_block(unsigned char *p, int nbytes)
+{
+  unsigned char *q;
+  unsigned char *end = p + nbytes;
+  while (p < end) {
+    q = memchr(p, '\r', end - p);
+    if (q == NULL) {
+      out_write(p, end - p);
+      return;
+    }
+    if (q > p)
+      out_write(p, q - p);
+    p = q + 1;
+  }
+}
+
+static void concat_file(char *fname)
 {
   FILE *f;
-  int i,j;
   int nbytes;
-  if (argc < 2) {
-    fprintf(stderr,"Usage: concat <pattern+>\n");
-    return 19;
+  f=fopen(fname,"rb");
+  if (f==NULL) {
+    fprintf(stderr,"Cannot open file %s\n",fname);
+    return;
+  }
+  while ((nbytes=fread(buf,1,BUF_SIZE,f)) > 0) {
+    if (raw_mode)
+      out_write(buf,nbytes);
+    else
+      write_block(buf,nbytes);
   }
+  fclose(f);
+}
 
-  for (i=1; i<argc; i++) {
-    f=fopen(argv[i],"rb");
-    if (f==NULL) {
-      fprintf(stderr,"Cannot open file %s\n",argv[i]);
-      continue;
+/* Skip a leading "./", it names the same file as the path without it. */
+static char *skip_dot(char *path)
+{
+  while (path[0] == '.' && path[1] == '/')
+    path += 2;
+  return path;
+}
+
+/* Concatenate all files matching a wildcard pattern in alphabetical order,
+   so parts of a split file are joined in the right order. The output
+   file is left out, it may match the pattern. Return false if there are
+   more matching files than fit in memory, nothing is written then. */
+static bool concat_pattern(char *pat, char *outname)
+{
+  DIR dir_struct;
+  FILINFO file_struct;
+  int res;
+  int i;
+  bool ok = true;
+  char *dirname = NULL;
+  char *p;
+  char namebuf[256];
+  p = my_rindex(pat, '/');
+  if (p != NULL) {
+    *p = 0;
+    dirname = p == pat ? "/" : pat;
+    pat = p+1;
+  }
+  glob_prepare(pat);
+  n_names = 0;
+  res = ffs_dopen(&dir_struct,dirname != NULL ? dirname : ".");
+  if (res == 0) {
+    for (;;) {
+      res = ffs_dread(&dir_struct,&file_struct);
+      if (res != 0 || file_struct.fname[0]==0)
+	break;
+      if ((file_struct.fattrib & 0x10) != 0 ||
+	  !glob_is_match(file_struct.fname,pat))
+	continue;
+      if (dirname == NULL)
+	snprintf(namebuf, sizeof namebuf, "%s", file_struct.fname);
+      else
+	snprintf(namebuf, sizeof namebuf, "%s%s%s", dirname,
+		 strcmp(dirname, "/") != 0 ? "/" : "", file_struct.fname);
+      if (outname != NULL &&
+	  my_strcasecmp(skip_dot(namebuf),skip_dot(outname)) == 0)
+	continue;
+      if (n_names == MAX_NAMES) {
+	fprintf(stderr,"Too many matching files\n");
+	ok = false;
+	break;
+      }
+      names[n_names] = strdup(namebuf);
+      if (names[n_names] == NULL) {
+	fprintf(stderr,"Not enough memory\n");
+	ok = false;
+	break;
+      }
+      n_names++;
+    }
+    ffs_dclose(&dir_struct);
+    if (!ok) {
+      for (i=0; i<n_names; i++)
+	free(names[i]);
+      return false;
     }
-    while ((nbytes=fread(buf,1,BUF_SIZE,f)) > 0) {
-      for (j=0; j<nbytes; j++) {
-	if (buf[j] != '\r') fputc(buf[j],stdout);
+  }
+  qsort(names, n_names, sizeof(char *), name_compare);
+  for (i=0; i<n_names; i++) {
+    concat_file(names[i]);
+    free(names[i]);
+  }
+  return true;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i;
+  int nopts = 0;
+  char *outname = NULL;
+  for (;;) {
+    if (argc < nopts+2) {
+      fprintf(stderr,"Usage: concat [-b] [-o <outfile>] <pattern+>\n");
+      return 19;
+    }
+    if (strcmp(argv[nopts+1],"-b")==0) {
+      raw_mode = true;
+      nopts += 1;
+    } else if (strcmp(argv[nopts+1],"-o")==0 && argc >= nopts+3) {
+      outname = argv[nopts+2];
+      nopts += 2;
+    } else {
+      break;
+    }
+  }
+  if (outname != NULL) {
+    out = fopen(outname,"wb");
+    if (out == NULL) {
+      fprintf(stderr,"Cannot create file %s\n",outname);
+      return 4;
+    }
+  } else {
+    out = stdout;
+  }
+  for (i=nopts+1; i<argc; i++) {
+    if (strpbrk(argv[i],"*?[,") != NULL) {
+      if (!concat_pattern(argv[i], outname)) {
+	out_flush();
+	if (outname != NULL)
+	  fclose(out);
+	return 17;
       }
+    } else {
+      concat_file(argv[i]);
     }
-    fclose(f);
   }
-  return 0;	 
+  out_flush();
+  if (outname != NULL)
+    fclose(out);
+  return 0;
 }
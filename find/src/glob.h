@@ -0,0 +1,134 @@
+/* Wildcard matching of file names, shared by find, grep, wc and mc.
+
+   A pattern consists of one or more alternatives separated by commas,
+   for example *.c,*.h  Each alternative may contain:
+   *      matches any sequence of characters, also an empty one.
+   ?      matches any single character.
+   [abc]  matches any of the characters in the brackets, ranges like
+          [a-z] are allowed and [!abc] matches any character not listed.
+   Matching is case-insensitive for ASCII letters.
+
+   Call glob_prepare once on a pattern before using it with
+   glob_is_match, it converts the pattern to upper case in place, so
+   only the names have to be converted while matching.
+ */
+
+#ifndef GLOB_H_
+#define GLOB_H_
+
+#include <stdbool.h>
+
+static char glob_upper(char c)
+{
+  if (c >= 'a' && c <= 'z')
+    c -= 0x20;
+  return c;
+}
+
+static void glob_prepare(char *pat)
+{
+  while (*pat) {
+    *pat = glob_upper(*pat);
+    pat++;
+  }
+}
+
+/* Return a pointer to the closing bracket of a character class starting
+   at p, or NULL if the [ is not closed (it is then an ordinary character) */
+static const char *glob_class_end(const char *p)
+{
+  p++;
+  if (*p == '!')
+    p++;
+  if (*p == ']')
+    p++; /* A ] directly after the [ is part of the class */
+  while (*p != 0 && *p != ']')
+    p++;
+  return *p == ']' ? p : NULL;
+}
+
+/* Test if (upper case) character c is in the class from p to q,
+   where p points to the [ and q to the ] */
+static bool glob_class_match(const char *p, const char *q, char c)
+{
+  bool negate = false;
+  bool found = false;
+  p++;
+  if (*p == '!') {
+    negate = true;
+    p++;
+  }
+  do {
+    if (p[1] == '-' && p+2 < q) {
+      if (c >= p[0] && c <= p[2])
+	found = true;
+      p += 3;
+    } else {
+      if (c == *p)
+	found = true;
+      p++;
+    }
+  } while (p < q);
+  return found != negate;
+}
+
+/* Match a name against a single alternative from pat to end.
+   No recursion: on a mismatch we only return to the most recent *
+   and let it absorb one more character of the name. */
+static bool glob_match_one(const char *name, const char *pat, const char *end)
+{
+  const char *star_p = NULL;
+  const char *star_n = NULL;
+  const char *q;
+  char c;
+  while (*name) {
+    c = glob_upper(*name);
+    if (pat < end && *pat == '*') {
+      star_p = ++pat;
+      star_n = name;
+      continue;
+    }
+    if (pat < end) {
+      if (*pat == '[' && (q = glob_class_end(pat)) != NULL) {
+	if (glob_class_match(pat, q, c)) {
+	  pat = q+1;
+	  name++;
+	  continue;
+	}
+      } else if (*pat == '?' || *pat == c) {
+	pat++;
+	name++;
+	continue;
+      }
+    }
+    if (star_p == NULL)
+      return false;
+    pat = star_p;
+    name = ++star_n;
+  }
+  while (pat < end && *pat == '*')
+    pat++;
+  return pat == end;
+}
+
+/* Match a name against a prepared pattern list */
+static bool glob_is_match(const char *name, const char *pat)
+{
+  const char *end;
+  const char *q;
+  for (;;) {
+    end = pat;
+    while (*end != 0 && *end != ',') {
+      if (*end == '[' && (q = glob_class_end(end)) != NULL)
+	end = q;
+      end++;
+    }
+    if (glob_match_one(name, pat, end))
+      return true;
+    if (*end == 0)
+      return false;
+    pat = end+1;
+  }
+}
+
+#endif
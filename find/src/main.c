@@ -1,5 +1,8 @@
 /* find
  * search the entire file system for file names conforming to a certain pattern
+ *
+ * find -index [<dir>] writes a name index file, find -l <pattern> searches
+ * only that index instead of walking all directories.
  */
 
 #include <stdlib.h>
@@ -8,6 +11,7 @@
 #include <ctype.h>
 #include <stdbool.h>
 #include <mos_api.h>
+#include "glob.h"
 
 
 #define MAX_DIRS 200
@@ -15,26 +19,201 @@ char *dirnames[MAX_DIRS];
 int write_idx=0;
 int read_idx=0;
 
-static bool glob_is_match(char *name, char *pat)
+/* The index file is a text file. A line starting with '/' is the name of
+   a directory, the lines following it are the names of the files in that
+   directory, sorted case-insensitively. */
+#define INDEX_NAME "/find.idx"
+#define INDEX_TMPNAME "/find.tmp"
+
+#define POOL_SIZE 4096
+#define MAX_NAMES 256
+static char namepool[POOL_SIZE];
+static char *names[MAX_NAMES];
+static unsigned int pool_used;
+static unsigned int n_names;
+
+static char buf[1024];
+static char linebuf[256];
+int file_idx = 0;
+int buf_filled = 0;
+FILE *f;
+
+static int my_strcasecmp(const char *p,const char *q)
+{
+  char c1,c2;
+  for(;;) {
+    c1 = *p++;
+    c2 = *q++;
+    if (c1 >= 'a' && c1 <= 'z') c1-=0x20;
+    if (c2 >= 'a' && c2 <= 'z') c2-=0x20;
+    if (c1 != c2) return c1-c2;
+    if ((c1 | c2 ) == 0) return 0;
+ }
+}
+
+static int name_compare(const void *a, const void *b)
+{
+  const char * const *n1 = a;
+  const char * const *n2 = b;
+  return my_strcasecmp(*n1,*n2);
+}
+
+static int nextchar(void)
+{
+  if (file_idx == buf_filled) {
+    buf_filled = fread(buf, 1, 1024, f);
+    if (buf_filled == 0) {
+      return -1;
+    }
+    file_idx = 0;
+  }
+  return (unsigned char)buf[file_idx++];
+}
+
+/* Read the next line into linebuf. The part of a line that does not fit
+   is skipped, so a long line is still a single record. */
+static bool nextline(void)
+{
+  int linelength = 0;
+  int c;
+  for (;;) {
+    c=nextchar();
+    if (c==-1) {
+      linebuf[linelength] = 0;
+      return linelength != 0;
+    }
+    else if (c=='\n') {
+      linebuf[linelength] = 0;
+      return true;
+    }
+    else if (linelength < (int)sizeof linebuf - 1) {
+      linebuf[linelength++]=c;
+    }
+  }
+}
+
+/* Return true if directory path is root or inside the tree below root. */
+static bool in_subtree(char *path, char *root)
 {
-  char *p;
-  if (*name == 0 && *pat == 0) {
+  unsigned int len = strlen(root);
+  if (root[1] == 0)
     return true;
-  } else if (*pat=='?' && *name != 0) {
-    return glob_is_match(name+1, pat+1);
-  } else if (*pat=='*') {
-    p = name;
-    do {
-      if (glob_is_match(p, pat+1)) {
-	return true;
+  return strncmp(path, root, len) == 0 && (path[len] == 0 || path[len] == '/');
+}
+
+/* Sort the collected names and write them to the index file. */
+static void flush_names(FILE *out)
+{
+  unsigned int i;
+  qsort(names, n_names, sizeof(char *), name_compare);
+  for (i=0; i<n_names; i++) {
+    fputs(names[i], out);
+    fputc('\n', out);
+  }
+  n_names = 0;
+  pool_used = 0;
+}
+
+static void add_name(FILE *out, char *name)
+{
+  unsigned int len = strlen(name) + 1;
+  if (n_names == MAX_NAMES || pool_used + len > POOL_SIZE) {
+    /* Very large directory, it is stored as several sorted runs. */
+    flush_names(out);
+  }
+  names[n_names] = namepool + pool_used;
+  strcpy(names[n_names++], name);
+  pool_used += len;
+}
+
+/* Walk all directories below root and append them to the index file. */
+static void index_tree(FILE *out, char *root)
+{
+  DIR dir_struct;
+  FILINFO file_struct;
+  int res;
+  char namebuf[256];
+  dirnames[write_idx++] = strdup(root);
+  while (dirnames[read_idx] != NULL) {
+      res = ffs_dopen(&dir_struct,dirnames[read_idx]);
+      if (res == 0) {
+	fprintf(out, "%s\n", dirnames[read_idx]);
+	for (;;) {
+	  res = ffs_dread(&dir_struct,&file_struct);
+	  if (res != 0 || file_struct.fname[0]==0)
+	    break;
+	  if ((file_struct.fattrib & 0x10) != 0) {
+	    strcpy(namebuf, dirnames[read_idx]);
+	    if (dirnames[read_idx][1] != 0)
+	      strcat(namebuf,"/");
+	    strcat(namebuf, file_struct.fname);
+	    if (write_idx < MAX_DIRS-1)
+	      dirnames[write_idx++] = strdup(namebuf);
+	  } else if (dirnames[read_idx][1] != 0 ||
+		     (strcmp(file_struct.fname, INDEX_NAME+1) != 0 &&
+		      strcmp(file_struct.fname, INDEX_TMPNAME+1) != 0)) {
+	    add_name(out, file_struct.fname);
+	  }
+	}
+	flush_names(out);
+	ffs_dclose(&dir_struct);
+      }
+      read_idx++;
+  }
+}
+
+/* Build the index. Directories outside root are copied from the old
+   index, so after changing a single directory tree only that tree
+   has to be read again. */
+static int build_index(char *root)
+{
+  FILE *out;
+  bool keep = false;
+  out = fopen(INDEX_TMPNAME, "wb");
+  if (out == NULL) {
+    fprintf(stderr,"Cannot create index file\n");
+    return 4;
+  }
+  if (root[1] != 0) {
+    f = fopen(INDEX_NAME, "rb");
+    if (f != NULL) {
+      while (nextline()) {
+	if (linebuf[0] == '/')
+	  keep = !in_subtree(linebuf, root);
+	if (keep) {
+	  fputs(linebuf, out);
+	  fputc('\n', out);
+	}
       }
-    } while (*p++);
-    return false;
-  } else if (toupper(*pat) == toupper(*name)) {
-    return glob_is_match(name+1, pat+1);
-  } else {
-    return false;
+      fclose(f);
+    }
   }
+  index_tree(out, root);
+  fclose(out);
+  mos_del(INDEX_NAME);
+  mos_ren(INDEX_TMPNAME, INDEX_NAME);
+  return 0;
+}
+
+/* Search the index instead of the file system. */
+static int search_index(char *pat)
+{
+  char dirbuf[256];
+  f = fopen(INDEX_NAME, "rb");
+  if (f == NULL) {
+    fprintf(stderr,"No index, run find -index first\n");
+    return 4;
+  }
+  dirbuf[0] = 0;
+  while (nextline()) {
+    if (linebuf[0] == '/') {
+      strcpy(dirbuf, linebuf);
+    } else if (glob_is_match(linebuf, pat)) {
+      printf("%s%s%s\n", dirbuf, dirbuf[1] != 0 ? "/" : "", linebuf);
+    }
+  }
+  fclose(f);
+  return 0;
 }
 
 int
@@ -45,9 +224,34 @@ main(int argc, char *argv[])
   int res;
   char namebuf[256];
   if (argc < 2) {
-    fprintf(stderr,"Usage: find <pattern>\n");
+    fprintf(stderr,"Usage: find [-l] <pattern>\n       find -index [<dir>]\n");
     return 19;
   }
+  if (strcmp(argv[1],"-index")==0) {
+    if (argc < 3) {
+      strcpy(namebuf, "/");
+    } else {
+      if (argv[2][0] == '/') {
+	strcpy(namebuf, argv[2]);
+      } else {
+	namebuf[0] = '/';
+	strcpy(namebuf+1, argv[2]);
+      }
+      res = strlen(namebuf);
+      if (res > 1 && namebuf[res-1] == '/')
+	namebuf[res-1] = 0;
+    }
+    return build_index(namebuf);
+  }
+  if (strcmp(argv[1],"-l")==0) {
+    if (argc < 3) {
+      fprintf(stderr,"Usage: find [-l] <pattern>\n       find -index [<dir>]\n");
+      return 19;
+    }
+    glob_prepare(argv[2]);
+    return search_index(argv[2]);
+  }
+  glob_prepare(argv[1]);
   dirnames[write_idx++] = strdup("/");
   while (dirnames[read_idx] != NULL) {
       res = ffs_dopen(&dir_struct,dirnames[read_idx]);
@@ -71,5 +275,5 @@ main(int argc, char *argv[])
       }
       read_idx++;
   }
-  return 0;	 
+  return 0;
 }
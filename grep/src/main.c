@@ -9,6 +9,7 @@
 #include <ctype.h>
 #include <stdbool.h>
 #include <mos_api.h>
+#include "../../find/src/glob.h"
 
 static char *my_index(char *s, char c)
 {
@@ -20,28 +21,6 @@ static char *my_index(char *s, char c)
   return NULL;
 }
 
-static bool glob_is_match(char *name, char *pat)
-{
-  char *p;
-  if (*name == 0 && *pat == 0) {
-    return true;
-  } else if (*pat=='?' && *name != 0) {
-    return glob_is_match(name+1, pat+1);
-  } else if (*pat=='*') {
-    p = name;
-    do {
-      if (glob_is_match(p, pat+1)) {
-	return true;
-      }
-    } while (*p++);
-    return false;
-  } else if (toupper(*pat) == toupper(*name)) {
-    return glob_is_match(name+1, pat+1);
-  } else {
-    return false;
-  }
-}
-
 bool nocase = false;
 bool singlefile = false;
 
@@ -151,10 +130,13 @@ main(int argc, char *argv[])
   pat = argv[1+nopts];
   if (nopts+3 == argc &&
       my_index(argv[nopts+2],'*')==0 &&
-      my_index(argv[nopts+2],'?')==0) { /* single file no wildcard */
+      my_index(argv[nopts+2],'?')==0 &&
+      my_index(argv[nopts+2],'[')==0 &&
+      my_index(argv[nopts+2],',')==0) { /* single file no wildcard */
     singlefile = true;
   }
   for (; nopts<argc-2; nopts++) {
+    glob_prepare(argv[2+nopts]);
     res = ffs_dopen(&dir_struct,".");
     if (res == 0) {
       for (;;) {
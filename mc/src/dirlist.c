@@ -14,6 +14,7 @@
 #include <mos_api.h>
 #include <agon/vdp_vdu.h>
 #include "mc.h"
+#include "../../find/src/glob.h"
 
 typedef struct {
   char * name;
@@ -224,28 +225,6 @@ void dirlist_select_file(struct dirlist *dir)
 }
 
 
-static bool is_match(char *name, char *pat)
-{
-  char *p;
-  if (*name == 0 && *pat == 0) {
-    return true;
-  } else if (*pat=='?' && *name != 0) {
-    return is_match(name+1, pat+1);
-  } else if (*pat=='*') {
-    p = name;
-    do {
-      if (is_match(p, pat+1)) {
-	return true;
-      }
-    } while (*p++);
-    return false;
-  } else if (toupper(*pat) == toupper(*name)) {
-    return is_match(name+1, pat+1);
-  } else {
-    return false;
-  }
-}
-
 /* Select files in the current directory list according to the indicated 
    pattern Update display with marked items. */
 void dirlist_select_pattern(uint8_t which, struct dirlist *dir, char *pat)
@@ -254,8 +233,9 @@ void dirlist_select_pattern(uint8_t which, struct dirlist *dir, char *pat)
   if (dir==0 || dir->n_entries == 0) {
     return;
   }
+  glob_prepare(pat);
   for (i=0; i<dir->n_entries; i++) {
-    if (!dir->entries[i].is_dir && is_match(dir->entries[i].name, pat)) {
+    if (!dir->entries[i].is_dir && glob_is_match(dir->entries[i].name, pat)) {
       dir->entries[i].is_tagged = true;
     }
   }
@@ -270,8 +250,9 @@ void dirlist_deselect_pattern(uint8_t which, struct dirlist *dir, char *pat)
   if (dir==0 || dir->n_entries == 0) {
     return;
   }
+  glob_prepare(pat);
   for (i=0; i<dir->n_entries; i++) {
-    if (!dir->entries[i].is_dir && is_match(dir->entries[i].name, pat)) {
+    if (!dir->entries[i].is_dir && glob_is_match(dir->entries[i].name, pat)) {
       dir->entries[i].is_tagged = false;
     }
   }
@@ -4,6 +4,7 @@
 ; Created:	29/12/2022
 ; Changed:	30/12/2022 handle length = 0 and length = 1
 ; Changed:      08/04/2924 adapt to ez80asm
+; Changed:	19/10/2026 multi-byte patterns and verify mode
 
   			.ASSUME	ADL = 1			
 			INCLUDE "mos_api.inc"
@@ -15,9 +16,19 @@
 			
   			include "init.inc"
 			include "parse.inc"
+			include "outhex.inc"
+
+MAX_PATTERN:		EQU	argv_ptrs_max-5		; A full argv is refused, see _main
 	
 
-; This program fills a memory region with the same byte. 
+; This program fills a memory region with the same byte, or with a
+; repeating pattern of several bytes. With -v it checks that the region
+; still holds the pattern and shows the first address that was changed.
+;
+; The pattern is written once at the start of the region, then LDIR copies
+; the region onto itself, shifted by the pattern length. As LDIR copies
+; one byte at a time from low to high addresses, this repeats the pattern
+; over the whole region.
 ; 
 ; The main routine
 ; IXU: argv - pointer to array of parameters
@@ -25,65 +36,162 @@
 ; Returns:
 ;  HL: Error code, or 0 if OK
 ;
-_main:			LD	A, C
+_main:			XOR	A
+			LD	(Verify), A
+			LD	A, C
 			CP 	#4
-			JR  	Z, main1
-			LD 	HL, s_USAGE		; Number of args not 3 or 4, print usage string and exit
-			CALL	PRSTR
+			JR  	C, main_usage
+			CP	argv_ptrs_max-1		; A full argv may have lost arguments
+			JR	NC, main_toomany
+			LD	HL, (IX+3)		; Is the first parameter -v?
+			LD	A, (HL)
+			CP	'-'
+			JR	NZ, main1
+			INC	HL
+			LD	A, (HL)
+			CP	'v'
+			JR	NZ, main_usage
+			INC	HL
+			LD	A, (HL)
+			OR	A
+			JR	NZ, main_usage
+			LD	A, 1
+			LD	(Verify), A
+			LEA	IX, IX+3
+			DEC	C
+main1:			LD	A, C
+			SUB	3
+			JR	C, main_usage
+			JR	Z, main_usage		; Need at least one byte.
+			CP	MAX_PATTERN+1
+			JR	C, main2
+main_usage:		LD 	HL, s_USAGE		; Wrong number of args, print usage string and exit
+			CALL	Print_String
+			LD	HL, 19
+			RET
+main_toomany:		LD	HL, s_TOOMANY
+			CALL	Print_String
 			LD	HL, 19
 			RET
-main1:			LD	HL, (IX+3)		; first parameter, address.
+main2:			LD	(Pat_Len), A
+			LD	HL, (IX+3)		; first parameter, address.
 			CALL	ASC_TO_NUMBER
 			JR	NC, main_badnum
-			PUSH 	DE
+			LD	(Start), DE
 			LD	HL, (IX+6)		; second parameter, length.
 			CALL	ASC_TO_NUMBER
-			JR	NC, main_badnum_pop1
-			PUSH	DE
-			LD	HL, (IX+9)		;
-mein2:			CALL	ASC_TO_NUMBER
-			JR	NC, main_badnum_pop2
-			LD	A, E
-			POP	BC
-			POP	DE
-			LD 	HL, 1
-			AND 	A
+			JR	NC, main_badnum
+			LD	(Size), DE
+			LEA	IX, IX+9
+			LD	IY, Pattern
+			LD	A, (Pat_Len)
+			LD	B, A
+@@:			LD	HL, (IX+0)		; Pattern bytes
+			CALL	ASC_TO_NUMBER
+			JR	NC, main_badnum
+			LD	(IY+0), E
+			INC	IY
+			LEA	IX, IX+3
+			DJNZ	@B
+			LD	HL, (Size)		; Clip pattern length to size.
+			LD	DE, 0
+			LD	A, (Pat_Len)
+			LD	E, A
+			AND	A
+			SBC	HL, DE
+			JR	NC, main3
+			ADD	HL, DE
+			LD	A, L
+			LD	(Pat_Len), A
+			OR	A
+			JR	Z, main_end		; Size is 0, nothing to do.
+main3:			LD	A, (Verify)
+			OR	A
+			JR	NZ, verify
+			LD	HL, Pattern		; Write the pattern once
+			LD	DE, (Start)
+			LD	BC, 0
+			LD	A, (Pat_Len)
+			LD	C, A
+			LDIR
+			LD	HL, (Size)		; And copy it over the rest of the region.
+			LD	BC, 0
+			LD	C, A
+			AND	A
 			SBC	HL, BC
-			JR	Z, main_fill1		; Special case if length=1
-			JR	NC, main_end		; No carry only if BC is 1 or less. So it must be 0 now.
-			LD	HL, 0
-			ADD	HL, DE			; Copy DE to HL
-			LD	(HL), A
-			INC	DE
-			DEC	BC
+			JR	Z, main_end		; Region was not larger than the pattern.
+			PUSH	HL
+			POP	BC
+			LD	HL, (Start)
 			LDIR				; The classic way to fill a memory regain on Z80		
 main_end:		LD	HL, 0
 			RET
-main_fill1:		LD	(DE),A			; Fill only one byte
-			JR	main_end
-main_badnum_pop2:	POP	HL
-main_badnum_pop1:	POP	HL
 main_badnum:		LD	HL, s_BADNUM
-			CALL	PRSTR
+			CALL	Print_String
 			LD	HL, 19
 			RET
-			
-; Print a zero-terminated string
-; Parameters:
-;  HL: Address of string (24-bit pointer)
+
+; Check the region against the pattern. The first Pat_Len bytes are compared
+; to the pattern, the rest of the region to the bytes Pat_Len positions
+; earlier, using CPI.
 ;
-PRSTR:			LD	A,(HL)
-			OR	A
-			RET	Z
-			RST.L	10h
+verify:			LD	HL, (Start)
+			LD	DE, Pattern
+			LD	A, (Pat_Len)
+			LD	B, A
+@@:			LD	A, (DE)
+			CP	(HL)
+			JR	NZ, verify_changed
 			INC	HL
-			JR	PRSTR
+			INC	DE
+			DJNZ	@B
+			LD	HL, (Size)
+			LD	BC, 0
+			LD	A, (Pat_Len)
+			LD	C, A
+			AND	A
+			SBC	HL, BC
+			JR	Z, verify_ok
+			PUSH	HL
+			POP	BC			; Bytes left to check
+			LD	HL, (Start)
+			LD	DE, 0
+			LD	E, A
+			ADD	HL, DE			; HL: start + Pat_Len
+			LD	DE, (Start)		; DE: start
+verify1:		LD	A, (DE)
+			INC	DE
+			CPI
+			JR	NZ, verify_ne
+			JP	PE, verify1
+verify_ok:		LD	HL, s_OK
+			CALL	Print_String
+			LD	HL, 0
+			RET
+verify_ne:		DEC	HL
+verify_changed:		PUSH	HL
+			LD	HL, s_CHANGED
+			CALL	Print_String
+			POP	HL
+			CALL	Print_Hex24
+			LD	HL, s_CRLF
+			CALL	Print_String
+			LD	HL, 0
+			RET
 
 ; Text messages
 ;
-s_USAGE:		DB	" Usage: memfill <addr> <size> <byteval>\r\n", 0
+s_USAGE:		DB	" Usage: memfill [-v] <addr> <size> <byteval> [<byteval>...]\r\n", 0
+s_TOOMANY:		DB	" Too many byte values\r\n", 0
 s_BADNUM:		DB	" Bad number\r\n", 0	
+s_OK:			DB	" Unchanged\r\n", 0
+s_CHANGED:		DB	" First changed address: &", 0
+s_CRLF:			DB	"\r\n", 0
 	
 ; RAM
-; 
-			
+;
+Verify:			DS	1			; Nonzero for -v
+Pat_Len:		DS	1
+Start:			DS	3
+Size:			DS	3
+Pattern:		DS	MAX_PATTERN
@@ -4,6 +4,7 @@
 ; Created:	27/12/2022
 ;
 ;  Change 09/04/2024 Adapted to  ez80asm
+;  Change 19/10/2026 Page index, backward paging and jumps
 
 			.ASSUME	ADL = 1			
 
@@ -16,9 +17,22 @@
 			ENDMACRO
 			
   			INCLUDE "init.inc"
+
+IN_BUFSIZE:		EQU	1024
+OUT_BUFSIZE:		EQU	1024
+SRCH_BUFSIZE:		EQU	4096
+MAX_PATTERN:		EQU	64
+MAX_PAGES:		EQU	2048			; Number of entries in the page index.
+FIL_OBJSIZE:		EQU	11			; Offset of file size in FIL structure.
 			
 ; A simple program to view text files. After each page, show --More--
 ;
+; While reading, the file offset of the start of each page is stored in
+; the page index (3 bytes offset, 1 byte prev_cr flag). This allows
+; going back to an earlier page with a seek instead of reading the file
+; again from the start. Jumping forward to a page not yet seen reads the
+; file without output until that page is found.
+;
 ; The main routine
 ; IXU: argv - pointer to array of parameters
 ;   C: argc - number of parameters
@@ -41,7 +55,13 @@ main1:			LD 	HL, (IX+3)		; source file name
 			CALL	PRSTR
 			LD	HL, 4			
 			RET
-main2: 			LD 	C, A    		; Store source file handle to C.
+main2: 			LD 	(File_Handle), A	; Store source file handle.
+			LD	C, A
+			MOSCALL	mos_getfil
+			LD	DE, FIL_OBJSIZE
+			ADD	HL, DE
+			LD	HL, (HL)
+			LD	(File_Size), HL		; Only used for percentage jumps, 24 bits is enough.
 			MOSCALL mos_sysvars
 			RES 	4, (IX+sysvar_vpd_pflags)		; Clear mode flag
 			LD 	HL, c_GETMODE
@@ -52,28 +72,44 @@ main_waitmode:		BIT	4, (IX+sysvar_vpd_pflags)
 			LD (prev_cr), A
 			LD (current_col), A
 			LD (num_lines), A
+			LD (Silent), A
+			LD (Pat_Len), A
+			LD 	HL, 0
+			LD	(File_Pos), HL
+			LD	(Buf_Idx), HL
+			LD	(Buf_Len), HL
+			LD	(Page_Num), HL
+			LD	(Page_Index), HL	; Page 0 starts at offset 0
+			LD	(Page_Index+3), A
+			INC	HL
+			LD	(Pages_Known), HL
+			LD	HL, Out_Buf
+			LD	(Out_Ptr), HL
 			LD 	A, 128
 			CALL	get_colour
 			LD	(fg_norm), A
+			LD	(fg_norm_end), A
 			ADD	A, 128
 			LD	(bg_inv), A
+			LD	(bg_inv_end), A
 			LD 	A, 129
 			CALL	get_colour
 			LD	(fg_inv), A
+			LD	(fg_inv_end), A
 			ADD	A, 128
 			LD	(bg_norm), A
- 			; Load one byte per character.
+			LD	(bg_norm_end), A
+			LD	(save_sp), SP		; Jumps to another page restart the loop from here.
+ 			; Process one byte per character.
 main_byte_loop:
-			MOSCALL mos_feof
-			CP 	1
-			JR 	Z, main_load_end
-			MOSCALL mos_fgetc		; Fortunately fgetc transparently passes all bytes.
-			; mos_fgetc does not set carry flag at EOF in MOS 1.02, bummer, therefore separate mos_feof call in the loop.
+			CALL	get_byte
+			JR	C, main_at_eof
+			LD	(cur_char), A
 			CP	9
 			JR 	NZ, main3
 			; Character is a TAB, expand into spaces, at least one space printed, until column pos is 8-aligned.
 @@:			LD	A, 32
-			RST.LIL 10h
+			CALL	put_char
 			CALL	do_advance
 			LD	A,(current_col)
 			AND 	07h
@@ -98,21 +134,131 @@ main5:			CP	127
 			JR	Z, main_not_cr		; Ignore DEL char
 			CP 	32
 			JR	C, main_not_cr		; Ignore control chars 0..31, exeept for TAB, CR, LF, tested earlier
-			RST.LIL	10h			; Print the character, all 322--127, 128-255 are printable.
+			CALL	put_char		; Print the character, all 322--127, 128-255 are printable.
 			CALL	do_advance
 main_not_cr:		XOR 	A
 			LD 	(prev_cr),A
 			JR	main_byte_loop			
+main_at_eof:		LD	A, (Silent)
+			AND	A
+			JR	Z, main_eof_shown
+			XOR	A			; End of file while looking for a page, show the last one.
+			LD	(Silent), A
+			LD	HL, (Page_Num)
+			JP	show_page
+main_eof_shown:		CALL	out_flush
+			LD	A, (current_col)
+			AND 	A
+			JR 	Z, main6		; Print CRLF if file does not end in newline.
+			LD 	A, 13		
+			RST.LIL 10h
+			LD 	A, 10
+			RST.LIL 10h
+			XOR	A
+			LD	(current_col), A
+main6:			LD	HL, (Page_Num)
+			LD	DE, 0
+			AND	A
+			SBC	HL, DE
+			JR	Z, main_load_end	; File fits on a single page, just exit.
+			LD	HL, c_END
+			LD	(Prompt), HL
+			CALL	PRCNTSTR		; At the end, still allow going back.
+			CALL	get_command
+			LD	HL, c_CLEAR
+			CALL	PRCNTSTR
 main_load_end:
+			LD	A, (File_Handle)
+			LD	C, A
 			MOSCALL mos_fclose 
 			LD	A, (current_col)
 			AND 	A
-			JR 	Z, main6		; Print CRLF if file does not end in newline.
+			JR 	Z, main7		; Print CRLF if file does not end in newline.
 			LD 	A, 13		
 			RST.LIL 10h
 			LD 	A, 10
 			RST.LIL 10h
-main6:			LD 	HL, 0
+main7:			LD 	HL, 0
+			RET
+
+; Get the next byte from the file, read in blocks of IN_BUFSIZE bytes.
+; Returns:
+;  A: The byte
+;  F: Carry set at end of file
+;
+get_byte:		LD	HL, (Buf_Idx)
+			LD	DE, (Buf_Len)
+			AND	A
+			SBC	HL, DE
+			JR	NZ, get_byte1
+			LD	A, (File_Handle)
+			LD	C, A
+			LD	HL, In_Buf
+			LD	DE, IN_BUFSIZE
+			MOSCALL	mos_fread
+			LD	(Buf_Len), DE
+			LD	HL, 0
+			LD	(Buf_Idx), HL
+			LD	A, D
+			OR	E
+			SCF
+			RET	Z			; Nothing read, end of file.
+get_byte1:		LD	HL, (Buf_Idx)
+			LD	DE, In_Buf
+			ADD	HL, DE
+			LD	A, (HL)
+			LD	HL, (Buf_Idx)
+			INC	HL
+			LD	(Buf_Idx), HL
+			LD	HL, (File_Pos)
+			INC	HL
+			LD	(File_Pos), HL
+			OR	A			; Clear carry
+			RET
+
+; Print a character, unless we are looking for a page without output.
+; The characters are collected in Out_Buf and sent to the VDP as one block,
+; when the buffer is full or before waiting for a key.
+; Parameters:
+;  A: Character to print
+;
+put_char:		PUSH	BC
+			LD	B, A
+			LD	A, (Silent)
+			OR	A
+			LD	A, B
+			POP	BC
+			RET	NZ
+			PUSH	HL
+			LD	HL, (Out_Ptr)
+			LD	(HL), A
+			INC	HL
+			LD	(Out_Ptr), HL
+			PUSH	DE
+			LD	DE, Out_Buf + OUT_BUFSIZE
+			OR	A
+			SBC	HL, DE
+			POP	DE
+			POP	HL
+			RET	NZ
+			; Buffer full, fall through to out_flush
+
+; Send the characters in Out_Buf to the VDP.
+;
+out_flush:		PUSH	HL
+			PUSH	BC
+			LD	HL, (Out_Ptr)
+			LD	BC, Out_Buf
+			OR	A
+			SBC	HL, BC
+			JR	Z, @F
+			PUSH	HL
+			POP	BC			; Number of bytes
+			LD	HL, Out_Buf
+			LD	(Out_Ptr), HL
+			RST.LIL	18h
+@@:			POP	BC
+			POP	HL
 			RET
 
 ; Print a counted string (preceded by a count byte)
@@ -120,15 +266,13 @@ main6:			LD 	HL, 0
 ;  HL: Address of string (24-bit pointer)
 ;
 PRCNTSTR:             					     
-			LD 	B, (HL)
+			LD	BC, 0
+			LD 	C, (HL)
 			XOR	A
-			CP	B
+			CP	C
 			RET 	Z
 			INC 	HL
-@@:			LD 	A, (HL)
-			RST.LIL 10h
-			INC 	HL
-			DJNZ 	@B
+			RST.LIL	18h			; Send the string in one call.
 			RET
 			
 ; Print a zero-terminated string
@@ -154,9 +298,9 @@ do_newline:		LD	A, (current_col)
 			CP	(IX+sysvar_scrCols)
 			JR	Z, nl_nocrlf		; Skip printing the newline if cursor has advanced to last screen position.
 			LD	A, 13
-			RST.LIL 10h
+			CALL	put_char
 			LD	A, 10
-			RST.LIL 10h
+			CALL	put_char
 nl_nocrlf:		XOR 	A
 			LD 	(current_col),A		; Clear column position
 			LD	A, (num_lines)
@@ -167,30 +311,491 @@ nl_nocrlf:		XOR 	A
 			RET	NZ			; Do we need a pause?
 			XOR 	A
 			LD	(num_lines), A		; Clear line counter
+			LD	A, (Silent)
+			AND	A
+			JR	NZ, nl_silent
+			CALL	out_flush
 			LD 	HL, c_MORE
+			LD	(Prompt), HL
 			CALL 	PRCNTSTR		; Print More message
+			CALL	get_command
+			LD	HL, c_CLEAR
+			CALL	PRCNTSTR
+			JP	new_page
+nl_silent:		CALL	new_page
+			LD	HL, (Page_Num)		; Stop if the new page was not stored (index full).
+			LD	DE, (Pages_Known)
+			AND	A
+			SBC	HL, DE
+			JR	NC, @F
+			LD	HL, (Target)
+			LD	DE, (File_Pos)
+			AND	A
+			SBC	HL, DE
+			RET	NC			; Page starts at or before the target, keep looking.
+@@:			XOR	A			; The previous page contains the target, show it.
+			LD	(Silent), A
+			LD	HL, (Page_Num)
+			DEC	HL
+			JP	show_page
+
+; Wait for a key at the --More-- prompt and handle it.
+; Returns only if the next page must be shown (or at the end, if we must quit).
+; Keys: q, Q, ESC: quit, b: previous page, g: first page, G: last page,
+; 0..9: jump to 0%..90% of the file, /: search, n: search again,
+; any other key: next page.
+;
+get_command:
 @@:
 			MOSCALL mos_getkey
 			AND 	A
 			JR	Z, @B
+get_command1:
 			CP	'Q'
 			JR	Z, do_quit
 			CP	'q'
 			JR	Z, do_quit
 			CP	27
 			JR	Z, do_quit
-			LD	HL, c_CLEAR
-			CALL	PRCNTSTR
+			CP	'b'
+			JR	Z, key_back
+			CP	'g'
+			JR	Z, key_top
+			CP	'G'
+			JR	Z, key_end
+			CP	'/'
+			JP	Z, key_search
+			CP	'n'
+			JP	Z, key_next
+			CP	'0'
+			RET	C
+			CP	'9'+1
+			JR	C, key_percent
 			RET
 do_quit:		LD	HL, c_CLEAR
 			CALL	PRCNTSTR
-			POP 	HL			; Remove caller address
+			LD	SP, (save_sp)		; Remove callers from the stack
 			JP	main_load_end
+key_back:		LD	HL, (Page_Num)		; Page_Num is the page now on screen
+			LD	DE, 0
+			AND	A
+			SBC	HL, DE
+			JP	Z, show_page		; Already at page 0, show it again.
+			LD	HL, (Page_Num)
+			DEC	HL
+			JP	show_page
+key_top:		LD	HL, 0
+			JP	show_page
+key_end:		LD	HL, 0FFFFFFh
+			LD	(Target), HL
+			JR	goto_offset
+key_percent:		SUB	'0'
+			LD	B, A
+			LD	HL, (File_Size)
+			CALL	div10
+			EX	DE, HL
+			LD	HL, 0
+			LD	A, B
+			AND	A
+			JR	Z, @F
+key_percent1:		ADD	HL, DE
+			DJNZ	key_percent1
+@@:			LD	(Target), HL
+			; Fall through to goto_offset
+
+; Show the page that contains the file offset in Target.
+; If the target is beyond the last page in the index, read on from there
+; without output, storing the page starts, until the page is found.
+;
+goto_offset:		LD	HL, (Pages_Known)
+			DEC	HL
+			PUSH	HL
+			CALL	page_entry
+			LD	DE, (HL)		; Start of last known page
+			LD	HL, (Target)
+			AND	A
+			SBC	HL, DE
+			POP	HL
+			JR	NC, goto_scan
+goto_search:		DEC	HL			; Search backward for the last page that starts before the target
+			PUSH	HL
+			CALL	page_entry
+			LD	DE, (HL)
+			LD	HL, (Target)
+			AND	A
+			SBC	HL, DE
+			POP	HL
+			JR	C, goto_search		; Always stops at page 0, which starts at offset 0.
+			JR	show_page
+goto_scan:		LD	A, 1
+			LD	(Silent), A
+			; Fall through to show_page
+
+; Seek to the start of a page in the index and show it from the top of
+; the screen (or read it without output if Silent is set).
+; Parameters:
+;  HL: Page number
+;
+show_page:		LD	SP, (save_sp)		; Can get here from within subroutines, restore stack.
+			LD	DE, (Pages_Known)
+			PUSH	HL
+			AND	A
+			SBC	HL, DE
+			POP	HL
+			JR	C, @F
+			EX	DE, HL			; Past the end of a full index, use the last page in it.
+			DEC	HL
+@@:			LD	(Page_Num), HL
+			CALL	page_entry
+			LD	DE, (HL)
+			INC	HL
+			INC	HL
+			INC	HL
+			LD	A, (HL)
+			LD	(prev_cr), A
+			LD	(File_Pos), DE
+			EX	DE, HL
+			LD	E, 0
+			LD	A, (File_Handle)
+			LD	C, A
+			MOSCALL	mos_flseek
+			LD	HL, 0
+			LD	(Buf_Idx), HL
+			LD	(Buf_Len), HL
+			XOR	A
+			LD	(current_col), A
+			LD	(num_lines), A
+			LD	A, (Silent)
+			AND	A
+			JP	NZ, main_byte_loop
+			LD	A, 12			; Clear the screen
+			RST.LIL	10h
+			JP	main_byte_loop
+
+; Ask for a pattern and search for it, starting at the next page.
+; An empty pattern repeats the previous search.
+;
+key_search:		CALL	clear_line
+			LD	A, '/'
+			RST.LIL	10h
+			LD	HL, Edit_Buf
+			LD	E, 1
+			LD	BC, MAX_PATTERN
+			MOSCALL	mos_editline
+			CP	27
+			JR	Z, key_search_cancel
+			LD	A, (Edit_Buf)
+			AND	A
+			JR	Z, key_next		; Empty, use the previous pattern.
+			LD	HL, Edit_Buf
+			LD	DE, Pattern
+			LD	B, 0
+@@:			LD	A, (HL)
+			LD	(DE), A
+			INC	HL
+			INC	DE
+			INC	B
+			AND	A
+			JR	NZ, @B
+			DEC	B
+			LD	A, B
+			LD	(Pat_Len), A
+			CALL	build_skip
+			; Fall through to key_next
+
+; Search the next occurrence of the pattern, starting at the next page.
+;
+key_next:		LD	A, (Pat_Len)
+			AND	A
+			JR	Z, key_search_cancel	; No pattern yet.
+			LD	HL, (File_Pos)
+			CALL	search_file
+			JR	C, key_not_found
+			LD	(Target), HL
+			JP	goto_offset
+key_not_found:		CALL	restore_pos
+			CALL	clear_line
+			LD	HL, s_NOTFOUND
+			CALL	PRSTR
+			JR	key_wait
+key_search_cancel:	CALL	clear_line
+			LD	HL, (Prompt)
+			CALL	PRCNTSTR
+key_wait:		MOSCALL mos_getkey
+			AND 	A
+			JR	Z, key_wait
+			JP	get_command1
+
+; Count a new page and store its start in the page index, if it is not
+; already there.
+;
+new_page:		LD	HL, (Page_Num)
+			INC	HL
+			LD	(Page_Num), HL
+			LD	DE, (Pages_Known)
+			AND	A
+			SBC	HL, DE
+			RET	NZ			; Page already known
+			LD	HL, MAX_PAGES
+			SBC	HL, DE
+			RET	Z			; Index full
+			EX	DE, HL
+			INC	HL
+			LD	(Pages_Known), HL
+			DEC	HL
+			CALL	page_entry
+			LD	DE, (File_Pos)
+			LD	(HL), DE
+			INC	HL
+			INC	HL
+			INC	HL
+			LD	A, (cur_char)		; If the page ends on a CR, a following LF must be skipped.
+			SUB	13
+			JR	Z, @F
+			LD	A, 0FFh
+@@:			INC	A
+			LD	(HL), A
+			RET
+
+;  Build the skip table for the search pattern. For each character it
+;  holds the distance from its last position in the pattern (not counting
+;  the last one) to the end of the pattern, or the pattern length if it
+;  does not occur. The entry for the last character of the pattern is
+;  set to 0, so the scan loop only stops on that character.
+;
+build_skip:		LD	HL, Skip_Tab
+			LD	A, (Pat_Len)
+			LD	B, 0
+@@:			LD	(HL), A
+			INC	HL
+			DJNZ	@B
+			LD	DE, Skip_Tab
+			LD	HL, Pattern
+			DEC	A
+			JR	Z, build_skip2
+			LD	B, A
+build_skip1:		LD	E, (HL)
+			LD	A, B
+			LD	(DE), A
+			INC	HL
+			DJNZ	build_skip1
+build_skip2:		LD	E, (HL)			; Last character
+			LD	A, E
+			LD	(Last_Char), A
+			LD	A, (DE)
+			LD	(Last_Skip), A		; Shift used when only the last character matches.
+			XOR	A
+			LD	(DE), A
+			RET
+
+; Search the file for the pattern, using the Horspool algorithm on the
+; raw file data. Nothing is shown, this is much faster than paging through
+; the text. The last Pat_Len-1 bytes of each block are kept at the start of
+; the buffer, so matches that cross a block boundary are found too. After
+; the data in the buffer, Pat_Len copies of the last pattern character are
+; stored as a sentinel, so the inner loop does not need an end test.
+; Parameters:
+;  HL: File offset to start the search
+; Returns:
+;  HL: File offset of the match
+;  F: Carry set if not found.
+;
+search_file:		PUSH	HL
+			LD	E, 0
+			LD	A, (File_Handle)
+			LD	C, A
+			MOSCALL	mos_flseek
+			POP	HL
+			LD	BC, 0
+			LD	A, (Pat_Len)
+			DEC	A
+			LD	C, A
+			AND	A
+			SBC	HL, BC
+			LD	(Srch_Base), HL		; File offset of first byte in Srch_Buf
+			LD	HL, Srch_Buf		; The kept bytes are zero at the start, they can't match.
+			LD	B, MAX_PATTERN
+@@:			LD	(HL), 0
+			INC	HL
+			DJNZ	@B
+			LD	HL, Srch_Buf
+			LD	BC, 0
+			LD	A, (Pat_Len)
+			LD	C, A
+			DEC	C
+			ADD	HL, BC			; Position of last char of first candidate.
+srch_read:		PUSH	HL
+			LD	HL, Srch_Buf
+			ADD	HL, BC
+			LD	DE, SRCH_BUFSIZE
+			LD	A, (File_Handle)
+			LD	C, A
+			MOSCALL	mos_fread
+			LD	A, D
+			OR	E
+			SCF
+			POP	HL
+			RET	Z			; End of file, not found.
+			PUSH	HL
+			LD	(Srch_Count), DE
+			LD	HL, Srch_Buf
+			LD	BC, 0
+			LD	A, (Pat_Len)
+			LD	C, A
+			DEC	C
+			ADD	HL, BC
+			ADD	HL, DE
+			LD	(Srch_End), HL
+			LD	B, A			; Store the sentinel
+			LD	A, (Last_Char)
+@@:			LD	(HL), A
+			INC	HL
+			DJNZ	@B
+			POP	HL
+			LD	DE, Skip_Tab
+			LD	BC, 0
+srch_loop:		LD	E, (HL)			; Inner loop, skip while the last character does not match.
+			LD	A, (DE)
+			OR	A
+			JR	Z, srch_check
+			LD	C, A
+			ADD	HL, BC
+			JR	srch_loop
+srch_check:		PUSH	HL
+			LD	BC, (Srch_End)
+			AND	A
+			SBC	HL, BC
+			JR	NC, srch_next_block
+			POP	HL
+			PUSH	HL
+			LD	BC, 0
+			LD	A, (Pat_Len)
+			LD	C, A
+			DEC	C
+			AND	A
+			SBC	HL, BC			; Start of candidate
+			LD	DE, Pattern
+			LD	A, C
+			AND	A
+			JR	Z, srch_found
+			LD	B, A
+@@:			LD	A, (DE)
+			CP	(HL)
+			JR	NZ, srch_mismatch
+			INC	HL
+			INC	DE
+			DJNZ	@B
+srch_found:		POP	HL			; Compute file offset of match
+			LD	BC, Srch_Buf
+			AND	A
+			SBC	HL, BC
+			LD	BC, 0
+			LD	A, (Pat_Len)
+			LD	C, A
+			DEC	C
+			AND	A
+			SBC	HL, BC
+			LD	BC, (Srch_Base)
+			ADD	HL, BC
+			AND	A
+			RET
+srch_mismatch:		POP	HL
+			LD	DE, Skip_Tab
+			LD	BC, 0
+			LD	A, (Last_Skip)
+			LD	C, A
+			ADD	HL, BC
+			JR	srch_loop
+srch_next_block:	LD	HL, (Srch_Base)		; Data in the buffer was kept bytes + Srch_Count
+			LD	BC, (Srch_Count)
+			ADD	HL, BC
+			LD	(Srch_Base), HL
+			LD	BC, 0
+			LD	A, (Pat_Len)
+			LD	C, A
+			DEC	C
+			JR	Z, @F
+			LD	HL, (Srch_End)		; Keep the last Pat_Len-1 bytes
+			AND	A
+			SBC	HL, BC
+			LD	DE, Srch_Buf
+			LDIR
+@@:			POP	HL			; Candidate position
+			LD	DE, (Srch_End)
+			AND	A
+			SBC	HL, DE			; Overshoot past the end
+			LD	BC, 0
+			LD	A, (Pat_Len)
+			LD	C, A
+			DEC	C
+			ADD	HL, BC
+			LD	DE, Srch_Buf
+			ADD	HL, DE
+			JP	srch_read
+
+; Seek back to the position just after the data in In_Buf, after a search.
+;
+restore_pos:		LD	HL, (Buf_Len)
+			LD	DE, (Buf_Idx)
+			AND	A
+			SBC	HL, DE
+			LD	DE, (File_Pos)
+			ADD	HL, DE
+			LD	E, 0
+			LD	A, (File_Handle)
+			LD	C, A
+			MOSCALL	mos_flseek
+			RET
+
+; Clear the bottom line and put the cursor at its start.
+;
+clear_line:		LD	A, 13
+			RST.LIL	10h
+			LD	B, (IX+sysvar_scrCols)
+			DEC	B
+@@:			LD	A, 32
+			RST.LIL	10h
+			DJNZ	@B
+			LD	A, 13
+			RST.LIL	10h
+			RET
+
+; Get the address of a page index entry.
+; Parameters:
+;  HL: Page number
+; Returns:
+;  HL: Address of entry
+;
+page_entry:		ADD	HL, HL
+			ADD	HL, HL
+			LD	DE, Page_Index
+			ADD	HL, DE
+			RET
+
+; Divide by 10.
+; Parameters:
+;  HL: Number to divide
+; Returns:
+;  HL: Quotient
+;
+div10:			PUSH	BC
+			LD	B, 24
+			XOR	A
+@@:			ADD	HL, HL
+			RLA
+			CP	10
+			JR	C, div10_1
+			SUB	10
+			INC	L
+div10_1:		DJNZ	@B
+			POP	BC
+			RET
 			
 ; Text messages
 ;
 s_ERROR_SRC:		DB 	" Cannot open source file\r\n", 0
 s_USAGE:		DB	" Usage: more <txtfile>\r\n", 0                                 
+s_NOTFOUND:		DB	"Pattern not found", 0
 c_MORE:			DB  	16 ;String length
 			DB	17
 fg_inv:			DB   	0 ; foregrond reverse
@@ -201,6 +806,16 @@ bg_inv:			DB	0 ; background reverse
 fg_norm:		DB      0 ; foreground normal
 			DB	17
 bg_norm:		DB      0 ; background normal
+c_END:			DB  	15 ;String length
+			DB	17
+fg_inv_end:		DB   	0 ; foregrond reverse
+			DB 	17
+bg_inv_end:		DB	0 ; background reverse
+			DB      "--End--"
+			DB 	17
+fg_norm_end:		DB      0 ; foreground normal
+			DB	17
+bg_norm_end:		DB      0 ; background normal
 c_CLEAR:		DB      10,13,32,32,32,32,32,32,32,32,13 ; Clear the --More-- output
 c_GETMODE:               DB	4, 15, 23,0,vdp_mode	; Get screen mode parameters. Also switch off paged mode.
 
@@ -225,5 +840,31 @@ get_colour:	    	RES     2,(IX+sysvar_vpd_pflags)
 current_col:		DS	1			; Current column on the screen.
 num_lines:		DS 	1			; Number of lines printed since last pause
 prev_cr:		DS	1			; flag to indicate previous char was CR.
-
-			
\ No newline at end of file
+cur_char:		DS	1			; Last character read from the file.
+Silent:			DS	1			; Nonzero if reading without output to find a page.
+File_Handle:		DS	1
+save_sp:		DS	3
+File_Pos:		DS	3			; File offset of the next byte in the buffer.
+File_Size:		DS	3
+Target:			DS	3			; File offset to jump to.
+Page_Num:		DS	3			; Number of the page on the screen.
+Pages_Known:		DS	3			; Number of entries in the page index.
+Buf_Idx:		DS	3
+Buf_Len:		DS	3
+In_Buf:			DS	IN_BUFSIZE
+Out_Ptr:		DS	3			; Next free position in Out_Buf.
+Out_Buf:		DS	OUT_BUFSIZE
+Page_Index:		DS	MAX_PAGES * 4
+Prompt:			DS	3			; Prompt on screen, c_MORE or c_END
+Pat_Len:		DS	1			; Length of search pattern, 0 if none yet.
+Last_Char:		DS	1			; Last character of the pattern.
+Last_Skip:		DS	1			; Skip table entry for the last character.
+Srch_Base:		DS	3			; File offset of start of Srch_Buf.
+Srch_Count:		DS	3			; Number of bytes read into Srch_Buf.
+Srch_End:		DS	3			; End of data in Srch_Buf.
+Pattern:		DS	MAX_PATTERN
+Edit_Buf:		DS	MAX_PATTERN
+			ALIGN	256
+Skip_Tab:		DS	256			; Must be on a 256 byte boundary.
+Srch_Buf:		DS	MAX_PATTERN + SRCH_BUFSIZE + MAX_PATTERN	; Kept bytes, data, sentinel
+			
@@ -7,39 +7,329 @@
 #include <stdbool.h>
 #include "edit.h"
 
+/* Sparse line index: line_index[i] is the text offset of the start of
+   line i*LINE_INDEX_STEP+1. Offsets count the text before the gap followed
+   by the text after it, so they do not change when the gap moves, only
+   when text is inserted or deleted. Only the first line_index_valid
+   entries are valid, an edit invalidates all entries after the current
+   line and they are recomputed when needed.
+*/
+#define LINE_INDEX_STEP 64
+#define LINE_INDEX_SIZE 4096
+static unsigned int line_index[LINE_INDEX_SIZE];
+static unsigned int line_index_valid = 1;
 
-void EDT_BufStartLine(void)
+
+/* Like memchr, but search backward from s+n-1 down to s. */
+unsigned char *EDT_MemRChr(unsigned char *s, unsigned char c, unsigned int n)
 {
-  while (EDT.gap_start > EDT.text_start &&
-	 EDT.gap_start[-1] != '\n') {
-    EDT_BufPrevChar();
+  unsigned char *p = s + n;
+  while (p > s) {
+    if (*--p == c)
+      return p;
   }
+  return NULL;
+}
+
+/* Move the gap to address p, which is either before the gap (the gap
+   will start at p) or after it (the gap will end at p). The text in
+   between is moved with one block move. */
+void EDT_BufMoveGapTo(unsigned char *p)
+{
+  unsigned int n;
+  if (p <= EDT.gap_start) {
+    n = EDT.gap_start - p;
+    EDT.gap_start -= n;
+    EDT.gap_end -= n;
+    memmove(EDT.gap_end, EDT.gap_start, n);
+  } else if (p > EDT.gap_end) {
+    n = p - EDT.gap_end;
+    memmove(EDT.gap_start, EDT.gap_end, n);
+    EDT.gap_start += n;
+    EDT.gap_end += n;
+  }
+}
+
+void EDT_BufStartLine(void)
+{
+  unsigned char *p = EDT_MemRChr(EDT.text_start, '\n',
+				 EDT.gap_start - EDT.text_start);
+  EDT_BufMoveGapTo(p ? p+1 : EDT.text_start);
 }
 
 void EDT_BufEndLine(void)
 {
-  while (*EDT.gap_end != '\n') {
-    EDT_BufNextChar();
-  }  
+  EDT_BufMoveGapTo(memchr(EDT.gap_end, '\n', EDT.text_end - EDT.gap_end));
 }
 
 
 int EDT_BufLenCurLine(void)
 {
-  int i=0;
-  while (EDT.gap_end[i] != '\n') {
-    i++;
+  unsigned char *p = memchr(EDT.gap_end, '\n', EDT.text_end - EDT.gap_end);
+  return p - EDT.gap_end;
+}
+
+
+
+/* Mark the text as changed at the current line. Text is only changed
+   at or after the gap, a mark after it would no longer be at the same
+   text, so it is cleared. */
+void EDT_BufChanged(void)
+{
+  unsigned int n;
+  EDT.is_changed=1;
+  if (EDT.mark_pos > (unsigned int)(EDT.gap_start - EDT.text_start))
+    EDT.mark_set = 0;
+  EDT_LexChanged(EDT.gap_start - EDT.text_start);
+  n = EDT.lineno > 0 ? (EDT.lineno-1) / LINE_INDEX_STEP + 1 : 1;
+  if (line_index_valid > n)
+    line_index_valid = n;
+}
+
+void EDT_BufResetIndex(void)
+{
+  line_index[0] = 0;
+  line_index_valid = 1;
+}
+
+/* Convert between addresses in the buffer and text offsets. */
+unsigned int EDT_BufOffset(unsigned char *p)
+{
+  if (p <= EDT.gap_start)
+    return p - EDT.text_start;
+  else
+    return p - EDT.gap_end + (EDT.gap_start - EDT.text_start);
+}
+
+unsigned char *EDT_BufAddr(unsigned int offs)
+{
+  unsigned int before = EDT.gap_start - EDT.text_start;
+  if (offs < before)
+    return EDT.text_start + offs;
+  else
+    return EDT.gap_end + (offs - before);
+}
+
+/* Move the gap to text offset offs, keeping the line number right. */
+void EDT_BufGotoOffset(unsigned int offs)
+{
+  unsigned char *p = EDT_BufAddr(offs);
+  if (p <= EDT.gap_start)
+    EDT.lineno -= EDT_BufCountLines(p, EDT.gap_start);
+  else
+    EDT.lineno += EDT_BufCountLines(EDT.gap_end, p);
+  EDT_BufMoveGapTo(p);
+}
+
+/* Return the offset of the line n lines after the line that starts at
+   offset offs, or of the last line if there are fewer lines. */
+static unsigned int EDT_BufSkipLines(unsigned int offs, unsigned int n)
+{
+  unsigned char *p = EDT_BufAddr(offs);
+  unsigned char *end;
+  unsigned char *q;
+  while (n > 0) {
+    end = p < EDT.gap_start ? EDT.gap_start : EDT.text_end;
+    q = memchr(p, '\n', end - p);
+    if (q == NULL) {
+      if (end == EDT.text_end)
+	break;
+      p = EDT.gap_end;
+      continue;
+    }
+    if (q+1 == EDT.text_end)
+      break; /* Do not move past the final newline */
+    p = q+1;
+    if (p == EDT.gap_start)
+      p = EDT.gap_end;
+    n--;
+  }
+  return EDT_BufOffset(p);
+}
+
+/* Move the gap to the start of line n (1-based), using the line index. */
+void EDT_BufGotoLine(unsigned int n)
+{
+  unsigned int i = (n-1) / LINE_INDEX_STEP;
+  if (i >= LINE_INDEX_SIZE)
+    i = LINE_INDEX_SIZE-1;
+  while (line_index_valid <= i) {
+    line_index[line_index_valid] =
+      EDT_BufSkipLines(line_index[line_index_valid-1], LINE_INDEX_STEP);
+    line_index_valid++;
   }
-  return i;
+  EDT_BufMoveGapTo(EDT_BufAddr(EDT_BufSkipLines(line_index[i],
+						n-1-i*LINE_INDEX_STEP)));
 }
 
+/* Search engine (Boyer-Moore-Horspool). fold_tab maps each byte to
+   the value used in comparisons, upper case for ASCII letters when
+   EDT.ignore_case is set. skip_tab gives the distance to shift the
+   search window, indexed by the folded byte at the end of the window
+   (forward) or at its start (backward).
+*/
+static unsigned char fold_tab[256];
+static unsigned char skip_tab[256];
+static unsigned char find_pat[SEARCH_LENGTH];
 
+static void EDT_FindPrepare(unsigned char *pat, unsigned int len,
+			    bool forward)
+{
+  unsigned int i;
+  for (i=0; i<256; i++) {
+    fold_tab[i] = i;
+    if (EDT.ignore_case && i >= 'a' && i <= 'z')
+      fold_tab[i] = i - 0x20;
+    skip_tab[i] = len;
+  }
+  for (i=0; i<len; i++)
+    find_pat[i] = fold_tab[pat[i]];
+  if (forward) {
+    for (i=0; i<len-1; i++)
+      skip_tab[find_pat[i]] = len-1-i;
+  } else {
+    for (i=len-1; i>0; i--)
+      skip_tab[find_pat[i]] = i;
+  }
+}
+
+static bool EDT_FindMatch(unsigned char *p, unsigned int len)
+{
+  unsigned int i;
+  for (i=0; i<len; i++) {
+    if (fold_tab[p[i]] != find_pat[i])
+      return false;
+  }
+  return true;
+}
+
+/* Find the prepared pattern after the gap, starting at p. */
+static unsigned char *EDT_FindFrom(unsigned char *p, unsigned int len)
+{
+  unsigned char last = find_pat[len-1];
+  unsigned char c;
+  while ((unsigned int)(EDT.text_end - p) >= len) {
+    c = fold_tab[p[len-1]];
+    if (c == last && EDT_FindMatch(p, len-1))
+      return p;
+    p += skip_tab[c];
+  }
+  return NULL;
+}
+
+/* Find the pattern after the cursor, starting at address p after the gap.
+   Return the address of the match or NULL. */
+unsigned char *EDT_BufFindF(unsigned char *pat, unsigned int len,
+			    unsigned char *p)
+{
+  if (len == 0 || len > SEARCH_LENGTH)
+    return NULL;
+  EDT_FindPrepare(pat, len, true);
+  return EDT_FindFrom(p, len);
+}
+
+/* Find the last occurrence of the pattern before the cursor. */
+unsigned char *EDT_BufFindB(unsigned char *pat, unsigned int len)
+{
+  unsigned int offs;
+  unsigned char first;
+  unsigned char c;
+  if (len == 0 || len > SEARCH_LENGTH ||
+      (unsigned int)(EDT.gap_start - EDT.text_start) < len)
+    return NULL;
+  EDT_FindPrepare(pat, len, false);
+  first = find_pat[0];
+  offs = EDT.gap_start - EDT.text_start - len;
+  for (;;) {
+    c = fold_tab[EDT.text_start[offs]];
+    if (c == first && EDT_FindMatch(EDT.text_start+offs, len))
+      return EDT.text_start+offs;
+    if (offs < skip_tab[c])
+      return NULL;
+    offs -= skip_tab[c];
+  }
+}
+
+/* Count the newlines from p up to q, both on the same side of the gap. */
+unsigned int EDT_BufCountLines(unsigned char *p, unsigned char *q)
+{
+  unsigned int n = 0;
+  while ((p = memchr(p, '\n', q - p)) != NULL) {
+    n++;
+    p++;
+  }
+  return n;
+}
+
+/* Replace the len bytes at the cursor by rep. Return false if there
+   is no room. */
+bool EDT_BufReplace(unsigned int len, unsigned char *rep, unsigned int rlen)
+{
+  if (EDT.gap_end - EDT.gap_start - 1 < (int)rlen - (int)len)
+    return false;
+  EDT_BufChanged();
+  EDT_UndoRecord(true, EDT.gap_start - EDT.text_start, EDT.gap_end, len, false);
+  EDT_UndoRecord(false, EDT.gap_start - EDT.text_start, rep, rlen, false);
+  EDT.gap_end += len;
+  memcpy(EDT.gap_start, rep, rlen);
+  EDT.gap_start += rlen;
+  EDT.curline_len += rlen - len;
+  EDT.curline_pos += rlen;
+  return true;
+}
+
+/* Replace all matches from the cursor to the end of the text in a single
+   pass. The text after the gap is copied into the gap and the
+   replacements are made on the way, so the gap is not moved once per
+   match. Afterwards the gap is just after the last match. The number of
+   replacements is added to *count. Return false if the text ran out of
+   memory, the gap is then before the first match not replaced.
+*/
+bool EDT_BufReplaceAll(unsigned char *pat, unsigned int len,
+		       unsigned char *rep, unsigned int rlen,
+		       unsigned int *count)
+{
+  unsigned char *src = EDT.gap_end;
+  unsigned char *dst = EDT.gap_start;
+  unsigned char *hit;
+  unsigned int n;
+  unsigned int done = 0;
+  unsigned int lines = 0;
+  bool ok = true;
+  if (len == 0 || len > SEARCH_LENGTH)
+    return true;
+  EDT_FindPrepare(pat, len, true);
+  while ((hit = EDT_FindFrom(src, len)) != NULL) {
+    /* Copy the text up to the match */
+    n = hit - src;
+    memmove(dst, src, n);
+    lines += EDT_BufCountLines(dst, dst + n);
+    dst += n;
+    src = hit;
+    if (src - dst - 1 < (int)rlen - (int)len) {
+      ok = false; /* Out of memory */
+      break;
+    }
+    if (done++ == 0)
+      EDT_BufChanged();
+    EDT_UndoRecord(true, dst - EDT.text_start, src, len, false);
+    EDT_UndoRecord(false, dst - EDT.text_start, rep, rlen, false);
+    memcpy(dst, rep, rlen);
+    dst += rlen;
+    src += len;
+  }
+  EDT.gap_start = dst;
+  EDT.gap_end = src;
+  EDT.lineno += lines;
+  *count += done;
+  return ok;
+}
 
 void EDT_BufInsertChar(unsigned char c)
 {
-  if (EDT.curline_len < 254 &&
-      EDT.gap_start < EDT.gap_end-1) {
-    EDT.is_changed=1;
+  if (EDT.gap_start < EDT.gap_end-1) {
+    EDT_BufChanged();
+    EDT_UndoRecord(false, EDT.gap_start - EDT.text_start, &c, 1, true);
     *EDT.gap_start++ = c;
     EDT.curline_len++;
     EDT.curline_pos++;
@@ -49,8 +339,10 @@ void EDT_BufInsertChar(unsigned char c)
 void EDT_BufInsertNL(void)
 {
   if (EDT.gap_start < EDT.gap_end-1) {
-    *EDT.gap_start++ = '\n';    
-    EDT.is_changed=1;
+    EDT_BufChanged();
+    EDT_UndoRecord(false, EDT.gap_start - EDT.text_start,
+		   (unsigned char *)"\n", 1, true);
+    *EDT.gap_start++ = '\n';
     EDT.lineno++;
     EDT.total_lines++;
   }
@@ -59,30 +351,26 @@ void EDT_BufInsertNL(void)
 
 void EDT_BufDeleteChar(void)
 {
+  EDT_UndoRecord(true, EDT.gap_start - EDT.text_start, EDT.gap_end, 1, true);
   EDT.gap_end++;
   EDT.curline_len--;
-  EDT.is_changed=1;
+  EDT_BufChanged();
 }
 
 /*
- * 
- * Check that length current line + length next line <= 254.
- * If so, delete newline char. decrease total number of lines,
+ * Delete newline char, decrease total number of lines.
  *
  * Pre: gap_end points to (non-final) newline.
  */
 void EDT_BufJoinLines(void)
 {
-  int nextlen;
-  if (EDT.gap_end < EDT.text_end) {
-    EDT_BufNextChar();
-    nextlen = EDT_BufLenCurLine();
-    if (EDT.curline_len + nextlen < 255) {
-      EDT.is_changed=1;
-      EDT.curline_len += nextlen;
-      EDT.gap_start--;
-      EDT.total_lines--;
-    }
+  if (EDT.gap_end < EDT.text_end-1) {
+    EDT_BufChanged();
+    EDT_UndoRecord(true, EDT.gap_start - EDT.text_start,
+		   EDT.gap_end, 1, true);
+    EDT.gap_end++;
+    EDT.curline_len += EDT_BufLenCurLine();
+    EDT.total_lines--;
   }
 }
 
@@ -117,24 +405,30 @@ void EDT_BufPrevChar(void)
 
 void EDT_BufAdjustCol(void)
 {
-  int targetcol = EDT.cursor_col_max;
-  int col=0;
+  unsigned int targetcol = EDT.cursor_col_max;
+  unsigned int col=0;
   int tabstop = EDT.tab_stop;
+  unsigned char *p = EDT.gap_end;
   EDT.curline_len=EDT_BufLenCurLine();
   if (targetcol == 0) {
     targetcol = EDT.cursor_col;
   }
   EDT.curline_pos = 0;
+  EDT.scroll_pos = 0;
+  EDT.scroll_col = 0;
   while (col < targetcol) {
-    if (*EDT.gap_end=='\n') return;
-    if (*EDT.gap_end=='\t') {
+    if (*p=='\n') {
+      EDT_BufMoveGapTo(p);
+      return;
+    }
+    if (*p++=='\t') {
       col = (col + tabstop) & (-tabstop);
     } else {
       col++;
     }
-    EDT_BufNextChar();  
     EDT.curline_pos++;
   }
+  EDT_BufMoveGapTo(p);
   if (col > EDT.cursor_col_max) {
     EDT.cursor_col_max = col;
   }    
@@ -146,6 +440,11 @@ void EDT_BufAdjustCol(void)
  */
 void EDT_BufDeleteLine(void)
 {
+  unsigned int n = EDT.curline_len;
+  EDT_BufChanged();
+  if (EDT.gap_end + n < EDT.text_end - 1)
+    n++;
+  EDT_UndoRecord(true, EDT.gap_start - EDT.text_start, EDT.gap_end, n, false);
   EDT.gap_end += EDT.curline_len;
   if (EDT.gap_end < EDT.text_end - 1) {
     /* Remove the trailing newline and decrease the number of lines.\
@@ -158,7 +457,7 @@ void EDT_BufDeleteLine(void)
 
 bool EDT_BufCopyLine(void)
 {
-  if (EDT.curline_len < EDT.mem_end-EDT.cut_end) {
+  if (EDT_UndoMakeRoom(EDT.curline_len+1)) {
     memcpy(EDT.cut_end, EDT.gap_end, EDT.curline_len+1);
     EDT.cut_end += EDT.curline_len+1;
     EDT.cut_lines++;
@@ -168,10 +467,34 @@ bool EDT_BufCopyLine(void)
   }
 }
 
+/* Copy the block of n bytes after the gap to the end of the cut buffer. */
+bool EDT_BufCopyBlock(unsigned int n)
+{
+  if (!EDT_UndoMakeRoom(n))
+    return false;
+  memcpy(EDT.cut_end, EDT.gap_end, n);
+  EDT.cut_end += n;
+  EDT.cut_lines += EDT_BufCountLines(EDT.gap_end, EDT.gap_end + n);
+  return true;
+}
+
+/* Remove the block of n bytes after the gap, with a single move of
+   gap_end. The final newline is never part of a block. */
+void EDT_BufDeleteBlock(unsigned int n)
+{
+  EDT_BufChanged();
+  EDT_UndoRecord(true, EDT.gap_start - EDT.text_start, EDT.gap_end, n, false);
+  EDT.total_lines -= EDT_BufCountLines(EDT.gap_end, EDT.gap_end + n);
+  EDT.gap_end += n;
+}
+
 void EDT_BufPaste(void)
 {
   if (EDT.gap_end - EDT.gap_start > EDT.cut_end-EDT.text_end &&
-      EDT.cut_lines>0) {
+      EDT.cut_end > EDT.text_end) {
+    EDT_BufChanged();
+    EDT_UndoRecord(false, EDT.gap_start - EDT.text_start, EDT.text_end,
+		   EDT.cut_end-EDT.text_end, false);
     memcpy(EDT.gap_start, EDT.text_end, EDT.cut_end-EDT.text_end);
     EDT.lineno += EDT.cut_lines;
     EDT.total_lines += EDT.cut_lines;
@@ -6,8 +6,37 @@
 #include <mos_api.h>
 #include <agon/vdp_vdu.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "edit.h"
 
+/* What the text rows of the screen show, one byte per character cell,
+   so only the changed parts of rows have to be sent to the VDP. The cells
+   of a row are first rendered in frame and then compared with shadow.
+   If there is no memory for them, a single row in row_cells is used and
+   every row is drawn completely. */
+#define CELL_LEFT 1  /* Inverse '<', line scrolled horizontally */
+#define CELL_RIGHT 2 /* Inverse '>', line does not fit */
+static unsigned char row_cells[2*MAX_SCR_COLS];
+static unsigned char *shadow = row_cells;
+static unsigned char *frame = row_cells + MAX_SCR_COLS;
+static bool have_shadow;
+static bool screen_valid;
+/* With syntax colouring, the class of each cell is kept in frame_hl and
+   shadow_hl, and the lexer state at the start of each row in row_state.
+   lex_changed is set when rendering a row changed the state at the start
+   of the next one. */
+static unsigned char *shadow_hl;
+static unsigned char *frame_hl;
+static unsigned char *row_state;
+static bool lex_changed;
+
+/* VDU output is collected in out_buf and sent with one mos_puts call,
+   instead of one putch call for each byte. */
+#define OUT_BUF_SIZE 256
+static char out_buf[OUT_BUF_SIZE];
+static unsigned int out_filled;
+
 
 unsigned int  EDT_GetKey(void)
 {
@@ -26,6 +55,7 @@ unsigned int  EDT_GetKey(void)
 
 void EDT_InitScreen(void)
 {
+  int n;
   /* Disable control keys */
   putch(23); putch(0); putch(0x98); putch(0);
   /* paged mode off */
@@ -41,8 +71,26 @@ void EDT_InitScreen(void)
     EDT.scr_rows = getsysvar_scrRows();
     EDT.scr_cols = getsysvar_scrCols();
   }
+  if (EDT.scr_cols > MAX_SCR_COLS)
+    EDT.scr_cols = MAX_SCR_COLS;
+  n = (EDT.scr_rows-2) * SCR_COLS;
+  shadow = malloc(EDT.highlight ? 4 * n + EDT.scr_rows : 2 * n);
+  if (shadow != NULL) {
+    frame = shadow + n;
+    have_shadow = true;
+    if (EDT.highlight) {
+      shadow_hl = frame + n;
+      frame_hl = shadow_hl + n;
+      row_state = frame_hl + n;
+      memset(shadow_hl, HL_NORMAL, 2 * n);
+      memset(row_state, 0, EDT.scr_rows);
+    }
+  } else {
+    shadow = row_cells;
+  }
   EDT.fgcolour = vdp_return_palette_entry_index(128);
   EDT.bgcolour = vdp_return_palette_entry_index(129);;
+  EDT.hl_colour[HL_NORMAL] = EDT.fgcolour;
 }
 
 void EDT_ExitScreen(void)
@@ -51,22 +99,58 @@ void EDT_ExitScreen(void)
   putch(23); putch(0); putch(0x98); putch(1);
 }
 
-  void EDT_InvVideo(void)
+static void EDT_OutFlush(void)
+{
+  if (out_filled > 0) {
+    mos_puts(out_buf, out_filled, 0);
+    out_filled = 0;
+  }
+}
+
+static void EDT_Out(unsigned char c)
+{
+  if (out_filled == OUT_BUF_SIZE)
+    EDT_OutFlush();
+  out_buf[out_filled++] = c;
+}
+
+static void EDT_OutSpaces(int n)
+{
+  while (n-- > 0)
+    EDT_Out(' ');
+}
+
+static void EDT_OutColours(int fg, int bg)
 {
-  putch(17);putch(EDT.bgcolour);putch(17);putch(128+EDT.fgcolour);
+  EDT_Out(17);EDT_Out(fg);EDT_Out(17);EDT_Out(128+bg);
+}
+
+static void EDT_OutCursor(int x, int y)
+{
+  EDT_Out(31);EDT_Out(x);EDT_Out(y);
+}
+
+void EDT_InvVideo(void)
+{
+  EDT_OutColours(EDT.bgcolour,EDT.fgcolour);
+  EDT_OutFlush();
 }
 
 void EDT_TrueVideo(void)
 {
-  putch(17);putch(EDT.fgcolour);putch(17);putch(128+EDT.bgcolour);
+  EDT_OutColours(EDT.fgcolour,EDT.bgcolour);
+  EDT_OutFlush();
 }
 
 void EDT_SetCursor(int x, int y)
 {
-  putch(31);putch(x);putch(y);
+  EDT_OutCursor(x,y);
+  EDT_OutFlush();
 }
 
-void EDT_ReadLine(unsigned char* buf, int len)
+/* Read a line into buf, return the key that ended it: Enter, or TAB if
+   tab_ends is set. */
+int EDT_ReadLine(unsigned char* buf, int len, bool tab_ends)
 {
   int i=0;
   int c;
@@ -78,9 +162,13 @@ void EDT_ReadLine(unsigned char* buf, int len)
     c=EDT_GetKey();
     switch(c) {
     case -1:
-      return;
+      return c;
     case 13:
-      return;
+      return c;
+    case 9:
+      if (tab_ends)
+	return c;
+      break;
     case 127:
       if (i>0) {
 	putch(127);
@@ -89,7 +177,7 @@ void EDT_ReadLine(unsigned char* buf, int len)
       }
       break;
     default:
-      if (i<len && c>=32) {
+      if (i<len && c>=32 && c<256) {
 	putch(c);
 	buf[i++]=c;
 	buf[i]=0;
@@ -114,98 +202,303 @@ void EDT_ClrEOL(void)
   n = SCR_COLS-x;
   if (y==EDT.scr_rows-1)
     n--;
-  for (int i=0; i<n; i++) putch(32);
+  EDT_OutSpaces(n);
+  EDT_OutFlush();
+}
+
+/* Return the column after character c at column col */
+static unsigned int EDT_NextCol(unsigned char c, unsigned int col)
+{
+  if (c=='\t')
+    return (col + EDT.tab_stop) & (-EDT.tab_stop);
+  else
+    return col + 1;
+}
+
+/* Find the cursor column in the current line, starting from the first
+   visible character, and scroll the line horizontally if the cursor
+   is not visible. The line is scrolled by half a screen at a time, so
+   it is only scanned from its start when the cursor moves to the left
+   of the visible part.
+*/
+static void EDT_ScrollCurrentLine(unsigned char *p)
+{
+  unsigned int col;
+  unsigned char *q;
+  if (EDT.scroll_pos > EDT.curline_pos) {
+    EDT.scroll_pos = 0;
+    EDT.scroll_col = 0;
+  }
+  col = EDT.scroll_col;
+  for (q = p + EDT.scroll_pos; q != EDT.gap_start; q++)
+    col = EDT_NextCol(*q, col);
+  EDT.cursor_col = col;
+  if (col - EDT.scroll_col + (EDT.scroll_pos > 0) > (unsigned int)SCR_COLS-2) {
+    /* Scroll so the cursor gets in the middle */
+    q = p + EDT.scroll_pos;
+    while (col - EDT.scroll_col > SCR_COLS/2) {
+      EDT.scroll_col = EDT_NextCol(*q++, EDT.scroll_col);
+      EDT.scroll_pos++;
+    }
+  }
+}
+
+/* Force a complete redraw by the next EDT_ShowScreen, after something else
+   was written to the screen. */
+void EDT_InvalidateScreen(void)
+{
+  screen_valid = false;
+}
+
+static unsigned char *EDT_FrameRow(int row)
+{
+  return have_shadow ? frame + row * SCR_COLS : frame;
+}
+
+static unsigned char *EDT_ShadowRow(int row)
+{
+  return have_shadow ? shadow + row * SCR_COLS : shadow;
+}
+
+/* The classes of the cells of a row, NULL without syntax colouring. */
+static unsigned char *EDT_FrameHl(int row)
+{
+  return frame_hl ? frame_hl + row * SCR_COLS : NULL;
 }
 
-unsigned char * EDT_RenderLine(unsigned char *p, bool is_current)
+static unsigned char *EDT_ShadowHl(int row)
 {
+  return shadow_hl ? shadow_hl + row * SCR_COLS : NULL;
+}
+
+/* Send the cells of a row that differ from the screen. */
+static void EDT_ShowRow(int row)
+{
+  unsigned char *f = EDT_FrameRow(row);
+  unsigned char *s = EDT_ShadowRow(row);
+  unsigned char *fh = EDT_FrameHl(row);
+  unsigned char *sh = EDT_ShadowHl(row);
   unsigned char c;
-  bool is_scrolled=false;
-  int col = 0;
-  unsigned char *q=p;
-  int tabstop = EDT.tab_stop;
-  if (is_current) {
-    /* First find out how much to scroll the line to the left if the current
-       edit position is beyond the width of the screen */
-    for(;;) {
-      if (q==EDT.gap_start) {
-	break;
-      }
-      if (*q=='\n') {
-	break;
-      }
-      if (*q++=='\t') {
-	col = (col + tabstop) & (-tabstop);
-	if (col>SCR_COLS-1)col=SCR_COLS-1;
-      } else {
-	col++;
-      }
-      if (col==SCR_COLS-1) {
-	col=1;
-	p = q;
-	is_scrolled=true;
+  unsigned char cls = HL_NORMAL;
+  int first = 0;
+  int last = SCR_COLS-1;
+  if (have_shadow) {
+    while (first < SCR_COLS && f[first] == s[first] &&
+	   (fh == NULL || fh[first] == sh[first]))
+      first++;
+    if (first == SCR_COLS)
+      return;
+    while (f[last] == s[last] && (fh == NULL || fh[last] == sh[last]))
+      last--;
+  }
+  EDT_OutCursor(first, row+1);
+  for (int x=first; x<=last; x++) {
+    c = f[x];
+    if (c == CELL_LEFT || c == CELL_RIGHT) {
+      EDT_OutColours(EDT.bgcolour,EDT.fgcolour);
+      EDT_Out(c == CELL_LEFT ? '<' : '>');
+      EDT_OutColours(EDT.fgcolour,EDT.bgcolour);
+      cls = HL_NORMAL;
+    } else {
+      if (fh != NULL && fh[x] != cls) {
+	/* Only send a colour where the class changes */
+	cls = fh[x];
+	EDT_Out(17); EDT_Out(EDT.hl_colour[cls]);
       }
+      EDT_Out(c);
     }
-    EDT.cursor_col=col;
   }
-  if (is_scrolled) {
-    EDT_InvVideo();
-    putch('<');
-    EDT_TrueVideo();
-    col=1;
+  if (cls != HL_NORMAL) {
+    EDT_Out(17); EDT_Out(EDT.fgcolour);
+  }
+  EDT_OutFlush();
+  memcpy(s+first, f+first, last-first+1);
+  if (fh != NULL)
+    memcpy(sh+first, fh+first, last-first+1);
+}
+
+/* Scroll rows top..bottom of the text area up (n>0) or down (n<0) by n
+   rows with the VDP, in a temporary text viewport. */
+static void EDT_ScrollRows(int top, int bottom, int n)
+{
+  int rows = bottom - top + 1;
+  EDT_Out(28); EDT_Out(0); EDT_Out(bottom+1); EDT_Out(SCR_COLS-1); EDT_Out(top+1);
+  for (int i = n < 0 ? -n : n; i > 0; i--) {
+    EDT_Out(23); EDT_Out(7); EDT_Out(0); EDT_Out(n > 0 ? 3 : 2); EDT_Out(0);
+  }
+  EDT_Out(26);
+  EDT_OutFlush();
+  if (n > 0) {
+    memmove(EDT_ShadowRow(top), EDT_ShadowRow(top+n), (rows-n) * SCR_COLS);
+    memset(EDT_ShadowRow(bottom-n+1), ' ', n * SCR_COLS);
+    if (shadow_hl != NULL) {
+      memmove(EDT_ShadowHl(top), EDT_ShadowHl(top+n), (rows-n) * SCR_COLS);
+      memset(EDT_ShadowHl(bottom-n+1), HL_NORMAL, n * SCR_COLS);
+    }
   } else {
-    col=0;
+    memmove(EDT_ShadowRow(top-n), EDT_ShadowRow(top), (rows+n) * SCR_COLS);
+    memset(EDT_ShadowRow(top), ' ', -n * SCR_COLS);
+    if (shadow_hl != NULL) {
+      memmove(EDT_ShadowHl(top-n), EDT_ShadowHl(top), (rows+n) * SCR_COLS);
+      memset(EDT_ShadowHl(top), HL_NORMAL, -n * SCR_COLS);
+    }
+  }
+}
+
+static bool EDT_SameRow(int frame_row, int shadow_row)
+{
+  return memcmp(EDT_FrameRow(frame_row), EDT_ShadowRow(shadow_row),
+		SCR_COLS) == 0 &&
+    (frame_hl == NULL ||
+     memcmp(EDT_FrameHl(frame_row), EDT_ShadowHl(shadow_row), SCR_COLS) == 0);
+}
+
+/* Lines inserted or deleted at the first changed row, or the whole text
+   moved up or down, show as rows that are on the screen already at another
+   place. Find the nearest such shift, two rows must match, and scroll the
+   rows below the first changed row by it. */
+static void EDT_ScrollChanged(void)
+{
+  int rows = EDT.scr_rows - 2;
+  int first = 0;
+  int n;
+  while (first < rows && EDT_SameRow(first, first))
+    first++;
+  for (n = 1; first + n < rows - 1; n++) {
+    if (EDT_SameRow(first, first + n) && EDT_SameRow(first + 1, first + n + 1)) {
+      EDT_ScrollRows(first, rows - 1, n);
+      return;
+    }
+    if (EDT_SameRow(first + n, first) && EDT_SameRow(first + n + 1, first + 1)) {
+      EDT_ScrollRows(first, rows - 1, -n);
+      return;
+    }
+  }
+}
+
+/* Render the line at p in row of the frame, return the start of the
+   next line. With syntax colouring, the line is lexed from the state in
+   row_state[row] and the state at its end is stored for the next row. */
+static unsigned char * EDT_RenderLine(unsigned char *p, int row, bool is_current)
+{
+  unsigned char c;
+  unsigned int col = 0; /* Column in the line */
+  int x = 0;		/* Column on the screen */
+  unsigned char *q;
+  unsigned char *f = EDT_FrameRow(row);
+  unsigned char *h = EDT_FrameHl(row);
+  bool lex = h != NULL && EDT.syntax; /* Without syntax all cells are normal */
+  unsigned char cls = HL_NORMAL;
+  int tabstop = EDT.tab_stop;
+  if (lex)
+    EDT_LexStart(row_state[row]);
+  if (is_current) {
+    EDT_ScrollCurrentLine(p);
+    if (EDT.scroll_pos > 0) {
+      if (lex)
+	for (q = p; q < p + EDT.scroll_pos; q++)
+	  EDT_LexChar(q);
+      if (h != NULL)
+	h[x] = HL_NORMAL;
+      f[x++] = CELL_LEFT;
+      col = EDT.scroll_col;
+      p += EDT.scroll_pos;
+    }
   }
   for(;;) {
     if (p==EDT.gap_start) {
       p=EDT.gap_end;
     }
+    if (lex && *p != '\n')
+      cls = EDT_LexChar(p);
     c=*p++;
     if (c=='\n') {
-      if (col==SCR_COLS) {
-	EDT_InvVideo();
-	putch('>');
-	EDT_TrueVideo();	
-      }  else if (is_current) {   
-	EDT_ClrEOL();
+      if (x==SCR_COLS) {
+	f[--x] = CELL_RIGHT;
       } else {
-	putch(13);putch(10);
+	memset(f+x, ' ', SCR_COLS-x);
       }
+      if (h != NULL)
+	memset(h+x, HL_NORMAL, SCR_COLS-x);
       break;
-    } else if (c=='\t' && col<SCR_COLS-1) {
+    } else if (c=='\t' && x<SCR_COLS-1) {
       do {
-	putch(' ');
+	if (h != NULL)
+	  h[x] = cls;
+	f[x++] = ' ';
 	col++;
-      } while ( (col & (tabstop-1)) && col < SCR_COLS-1);
-    } else if (col<SCR_COLS-1) {
-      putch(c);
+      } while ( (col & (tabstop-1)) && x < SCR_COLS-1);
+    } else if (x<SCR_COLS-1) {
+      if (h != NULL)
+	h[x] = cls;
+      f[x++] = c;
       col++;
     } else {
-      col = SCR_COLS;
+      /* Rest of the line is not visible, skip to its end */
+      x = SCR_COLS;
+      if (lex) {
+	/* The lexer needs all of it for the state of the next line */
+	for (;;) {
+	  if (p==EDT.gap_start)
+	    p=EDT.gap_end;
+	  if (*p == '\n')
+	    break;
+	  EDT_LexChar(p++);
+	}
+	continue;
+      }
+      p--;
+      if (p < EDT.gap_start) {
+	q = memchr(p, '\n', EDT.gap_start - p);
+	p = q ? q : EDT.gap_end;
+      }
+      if (*p != '\n')
+	p = memchr(p, '\n', EDT.text_end - p);
+    }
+  }
+  if (lex) {
+    c = EDT_LexEnd();
+    if (row_state[row+1] != c) {
+      row_state[row+1] = c;
+      lex_changed = true;
     }
   }
   return p;
 }
 
+/* Render the rows below row, starting with the line at p, as long as
+   the lexer state at their start changed. */
+static void EDT_RenderBelow(int row, unsigned char *p)
+{
+  while (lex_changed && ++row < EDT.scr_rows - 2 && p != EDT.text_end) {
+    lex_changed = false;
+    p = EDT_RenderLine(p, row, false);
+    EDT_ShowRow(row);
+  }
+  lex_changed = false;
+}
+
 void EDT_RenderCurrentLine(void)
 {
-  EDT_SetCursor(0,
-		EDT.cursor_row+1);
-  EDT_RenderLine(EDT.gap_start-EDT.curline_pos,true);
+  unsigned char *p;
+  p = EDT_RenderLine(EDT.gap_start-EDT.curline_pos,EDT.cursor_row,true);
+  EDT_ShowRow(EDT.cursor_row);
+  EDT_RenderBelow(EDT.cursor_row, p);
   EDT_ShowCursor();
 }
 
 void EDT_LeaveCurrentLine(void)
 {
-  EDT_SetCursor(0,
-		EDT.cursor_row+1);
-  EDT_RenderLine(EDT.gap_start-EDT.curline_pos,false);
+  unsigned char *p;
+  p = EDT_RenderLine(EDT.gap_start-EDT.curline_pos,EDT.cursor_row,false);
+  EDT_ShowRow(EDT.cursor_row);
+  EDT_RenderBelow(EDT.cursor_row, p);
 }
 
 
 void EDT_ShowCursor(void)
 {
-  EDT_SetCursor(EDT.cursor_col,
+  EDT_SetCursor(EDT.cursor_col - EDT.scroll_col + (EDT.scroll_pos > 0),
 		EDT.cursor_row+1);
   if (EDT.cursor_col_max < EDT.cursor_col) {
     EDT.cursor_col_max = EDT.cursor_col;
@@ -213,33 +506,79 @@ void EDT_ShowCursor(void)
 }
 
 
+/* Show an inverse status line of n characters, padded to width. */
+static void EDT_OutStatus(char *line, int n, int width)
+{
+  if (n > width)
+    n = width;
+  EDT_OutColours(EDT.bgcolour,EDT.fgcolour);
+  for (int i=0; i<n; i++)
+    EDT_Out(line[i]);
+  EDT_OutSpaces(width-n);
+  EDT_OutColours(EDT.fgcolour,EDT.bgcolour);
+  EDT_OutFlush();
+}
+
 void EDT_ShowBottom(void)
 {
-  EDT_SetCursor(0,EDT.scr_rows-1);
-  EDT_InvVideo(); 
-  printf("Line %d/%d, %d/%d bytes -- ESC to exit, ^G for help %c Cut %d",
-		 EDT.lineno,
-		 EDT.total_lines,
-		 EDT.gap_start-EDT.text_start + EDT.text_end-EDT.gap_end,
-		 EDT.text_end - EDT.text_start,
-		 EDT.is_changed?'*':' ',
-		 EDT.cut_lines
-		 );
-  EDT_ClrEOL();
-  EDT_TrueVideo();
+  char line[MAX_SCR_COLS+1];
+  int n;
+  n = snprintf(line, sizeof line,
+	       "Line %d/%d, %d/%d bytes -- %s %c Cut %d",
+	       EDT.lineno + EDT.lines_before,
+	       EDT.total_lines + EDT.lines_before + EDT.lines_after,
+	       EDT.gap_start-EDT.text_start + EDT.text_end-EDT.gap_end,
+	       EDT.text_end - EDT.text_start,
+	       EDT.mark_set ? "Mark set" : "ESC to exit, ^G for help",
+	       EDT.is_changed?'*':' ',
+	       EDT.cut_lines
+	       );
+  EDT_OutCursor(0,EDT.scr_rows-1);
+  EDT_OutStatus(line, n, SCR_COLS-1);
 }
 
 void EDT_ShowScreen(void)
 {
   unsigned char *p = EDT.top_line;
-  putch(12);
-  EDT_InvVideo();
-  printf("Nano Extended: %s",EDT.mem_start+FILENAME_OFFS);
-  EDT_ClrEOL();
-  EDT_TrueVideo();
-
-  for (int i=0; i<EDT.scr_rows-2 && p!=EDT.text_end; i++) {
-    p = EDT_RenderLine(p,i==EDT.cursor_row);
+  int rows = EDT.scr_rows - 2;
+  if (!screen_valid) {
+    char line[MAX_SCR_COLS+1];
+    int n;
+    EDT_Out(12);
+    if (EDT_FilesCount() > 1)
+      n = snprintf(line, sizeof line, "Nano Extended: %s (%d/%d)",
+		   EDT.mem_start+FILENAME_OFFS, EDT_FilesCurrent()+1,
+		   EDT_FilesCount());
+    else
+      n = snprintf(line, sizeof line, "Nano Extended: %s",
+		   EDT.mem_start+FILENAME_OFFS);
+    EDT_OutStatus(line, n, SCR_COLS);
+    if (have_shadow)
+      memset(shadow, ' ', rows * SCR_COLS);
+    if (shadow_hl != NULL)
+      memset(shadow_hl, HL_NORMAL, rows * SCR_COLS);
+    screen_valid = have_shadow;
+  }
+  if (EDT.syntax && frame_hl != NULL)
+    row_state[0] = EDT_LexTop(p);
+  for (int i=0; i<rows; i++) {
+    if (p != EDT.text_end) {
+      p = EDT_RenderLine(p,i,i==EDT.cursor_row);
+    } else if (have_shadow) {
+      memset(EDT_FrameRow(i), ' ', SCR_COLS);
+      if (frame_hl != NULL)
+	memset(EDT_FrameHl(i), HL_NORMAL, SCR_COLS);
+    } else {
+      break;
+    }
+    if (!have_shadow)
+      EDT_ShowRow(i);
+  }
+  lex_changed = false;
+  if (have_shadow) {
+    EDT_ScrollChanged();
+    for (int i=0; i<rows; i++)
+      EDT_ShowRow(i);
   }
   EDT_ShowBottom();
   EDT_ShowCursor();
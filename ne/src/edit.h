@@ -4,6 +4,7 @@
 */
 
 #include <mos_api.h>
+#include <stdio.h>
 #include <stdbool.h>
 
 #define VKEY_UP  150
@@ -21,6 +22,15 @@
 #define EDIT_BUF_SIZE (400*1024)
 #define CUT_BUF_SIZE (32*1024)
 #define MAX_NAME_LENGTH 128
+#define SEARCH_LENGTH 40
+
+/* Syntax colouring classes of characters */
+#define HL_NORMAL 0
+#define HL_KEYWORD 1
+#define HL_COMMENT 2
+#define HL_STRING 3
+#define HL_NUMBER 4
+#define HL_CLASSES 5
 
 /* Global editor state is only the _EditState structure and the
    emeory space (allocated at startup).
@@ -34,15 +44,20 @@ struct _EditState {
   unsigned char *gap_end;
   unsigned char *text_end;
   unsigned char *cut_end;  
+  unsigned char *undo_start; /* Undo journal */
+  unsigned char *undo_pos;   /* Records after this can be redone */
+  unsigned char *undo_end;
   unsigned char *mem_end;
   unsigned int lineno; /* Line number at cursor (1-based) */
   unsigned int total_lines; /* Number of lines of text in buffer */
   unsigned int cut_lines;
   unsigned char is_changed;   /* Flag to indicate if file is changed */
-  unsigned char curline_pos;   /* Position within current line of cursor */
-  unsigned char curline_len;    /*  Lenght of current line in bytes */
-  unsigned char cursor_col_max;   /* Cursor column to which we may return if we move to a longer line */
-  unsigned char cursor_col;   /*  Cursor column (can be >= 80) for long lines. */
+  unsigned int curline_pos;   /* Position within current line of cursor */
+  unsigned int curline_len;    /*  Lenght of current line in bytes */
+  unsigned int cursor_col_max;   /* Cursor column to which we may return if we move to a longer line */
+  unsigned int cursor_col;   /*  Cursor column in the line, tabs expanded */
+  unsigned int scroll_pos;   /* Position in current line of first visible char */
+  unsigned int scroll_col;   /* Its column, the line is scrolled left by this */
   unsigned char cursor_row;    /* Cursor row 0 is top of text area */
   unsigned char tab_stop;        /* Tab stops at 4 or 8 chars? */
   unsigned char scr_rows;        /* Number of text rows on the screen (30 or 60) */
@@ -50,6 +65,16 @@ struct _EditState {
   unsigned char fgcolour;       /* foreground colour */
   unsigned char bgcolour;       /* background colour */
   unsigned char scr_cols;       /* Number of text columns on the screen (>=80)*/
+  unsigned char ignore_case;    /* Search ignores case of ASCII letters */
+  unsigned char paged;          /* Only a window of the file is in memory */
+  unsigned int lines_before;    /* Lines of the file before the window */
+  unsigned int lines_after;     /* Lines of the file after the window */
+  unsigned char cut_block;      /* Cut buffer holds a block, not whole lines */
+  unsigned char mark_set;       /* A block is marked from the mark to the cursor */
+  unsigned int mark_pos;        /* Text offset of the mark */
+  unsigned char highlight;      /* Syntax colouring is enabled */
+  unsigned char syntax;         /* Language of the text, 0 for none (syntax.c) */
+  unsigned char hl_colour[HL_CLASSES]; /* Colours of the syntax classes */
 };
 
 extern struct _EditState EDT;
@@ -62,7 +87,9 @@ extern struct _EditState EDT;
    gap_end <= addr < text_end:     text at cursor and after (file always ends
                                    with newline that cursor cannot move past).
    text_end <= addr < cut_end      text in cut buffer.
-   cut_end <= addr < mem_end       free space after cut buffer.
+   cut_end <= addr < mem_end       free space after cut buffer, it holds
+                                   the undo journal from undo_start to
+                                   undo_end (see undo.c).
 */
    
 #define FILENAME_OFFS 0
@@ -71,28 +98,34 @@ extern struct _EditState EDT;
   /* n+1 bytes n-byte null-terminaed backup filename */
 #define SEARCHSTRING_OFFS (BACKFILENAME_OFFS+MAX_NAME_LENGTH+1)
   /* n+1 bytes n-byte null-terminated search string */
-#define LINENOSTRING_OFFS (SEARCHSTRING_OFFS+41)
-  /* 5 bytes 4-byte type buffer for line number */
-#define VAR_END_OFFS (LINENOSTRING_OFFS + 5)
+#define REPLACESTRING_OFFS (SEARCHSTRING_OFFS+SEARCH_LENGTH+1)
+  /* n+1 bytes n-byte null-terminated replacement string */
+#define LINENOSTRING_OFFS (REPLACESTRING_OFFS+SEARCH_LENGTH+1)
+  /* 8 bytes 7-byte type buffer for line number */
+#define VAR_END_OFFS (LINENOSTRING_OFFS + 8)
   /* Offset where we can have the text_start pointer */
 
 #define SCR_COLS (EDT.scr_cols) /* The number of columns is set fixed to 80 */
+#define MAX_SCR_COLS 128
 
 void EDT_EditCore(void);
 unsigned int  EDT_GetKey(void);
 void EDT_InitScreen(void);
 void EDT_ExitScreen(void);
+unsigned int EDT_FilterText(unsigned char *p, unsigned int n);
 void EDT_LoadFile(unsigned char *name);
 bool EDT_SaveFile(unsigned char *name);
+bool EDT_WriteText(FILE *fp, unsigned char *p, unsigned int n);
+bool EDT_WriteBlock(unsigned char *name, unsigned char *p, unsigned int n);
 void EDT_LoadConfig(char *name);
 void EDT_InvVideo(void);
 void EDT_TrueVideo(void);
 void EDT_SetCursor(int x, int y);
 void EDT_ClrEOL(void);
-void EDT_ReadLine(unsigned char* buf, int len);
-unsigned char * EDT_RenderLine(unsigned char *p, bool is_current);
+int EDT_ReadLine(unsigned char* buf, int len, bool tab_ends);
 void EDT_RenderCurrentLine(void);
 void EDT_LeaveCurrentLine(void);
+void EDT_InvalidateScreen(void);
 void EDT_ShowScreen(void);
 void EDT_ShowCursor(void);
 void EDT_ShowBottom(void);
@@ -112,4 +145,59 @@ void EDT_BufPrevChar(void);
 void EDT_BufAdjustCol(void);
 void EDT_BufDeleteLine(void);
 bool EDT_BufCopyLine(void);
+bool EDT_BufCopyBlock(unsigned int n);
+void EDT_BufDeleteBlock(unsigned int n);
 void EDT_BufPaste(void);
+void EDT_BufChanged(void);
+void EDT_BufResetIndex(void);
+unsigned int EDT_BufOffset(unsigned char *p);
+unsigned char *EDT_BufAddr(unsigned int offs);
+void EDT_BufMoveGapTo(unsigned char *p);
+void EDT_BufGotoOffset(unsigned int offs);
+void EDT_BufGotoLine(unsigned int n);
+unsigned char *EDT_BufFindF(unsigned char *pat, unsigned int len,
+			    unsigned char *p);
+unsigned char *EDT_BufFindB(unsigned char *pat, unsigned int len);
+unsigned int EDT_BufCountLines(unsigned char *p, unsigned char *q);
+unsigned char *EDT_MemRChr(unsigned char *s, unsigned char c, unsigned int n);
+bool EDT_BufReplace(unsigned int len, unsigned char *rep, unsigned int rlen);
+bool EDT_BufReplaceAll(unsigned char *pat, unsigned int len,
+		       unsigned char *rep, unsigned int rlen,
+		       unsigned int *count);
+
+void EDT_UndoReset(void);
+void EDT_UndoBegin(void);
+bool EDT_UndoMakeRoom(unsigned int n);
+void EDT_UndoRecord(bool del, unsigned int offs, unsigned char *data,
+		    unsigned int n, bool merge);
+bool EDT_Undo(void);
+bool EDT_Redo(void);
+
+bool EDT_PageOpen(unsigned char *filename);
+void EDT_PageClose(void);
+void EDT_PageCheck(void);
+bool EDT_PageForward(void);
+bool EDT_PageBackward(void);
+bool EDT_PageBackup(char *filename, char *backname);
+bool EDT_PageWriteHead(FILE *fp);
+bool EDT_PageWriteTail(FILE *fp);
+void EDT_PageSaved(char *filename, long pos);
+
+void EDT_SyntaxInit(void);
+void EDT_SyntaxKeyword(unsigned char *lang_name, unsigned char *word);
+void EDT_SyntaxColour(unsigned char *class_name, unsigned char *colour);
+void EDT_SyntaxSelect(unsigned char *filename);
+void EDT_LexChanged(unsigned int offs);
+void EDT_LexStart(unsigned char state);
+unsigned char EDT_LexEnd(void);
+unsigned char EDT_LexChar(unsigned char *p);
+unsigned char EDT_LexTop(unsigned char *top);
+
+void EDT_FilesInit(void);
+int EDT_FilesCount(void);
+int EDT_FilesCurrent(void);
+bool EDT_FilesNext(void);
+void EDT_FilesOwnCut(void);
+void EDT_FilesTakeCut(void);
+bool EDT_FilesOpen(unsigned char *name);
+bool EDT_FilesClose(void);
@@ -138,11 +138,37 @@ static void EDT_InsertChar(int c)
   EDT_RenderCurrentLine();
 }
 
+/* Put the cursor at address p in the text, keeping the line number
+   right. */
+static void EDT_CursorAt(unsigned char *p)
+{
+  EDT_BufGotoOffset(EDT_BufOffset(p));
+  p = EDT.gap_start;
+  EDT_BufStartLine();
+  EDT.cursor_col=0;
+  EDT.cursor_col_max=0;
+  EDT_BufAdjustCol();
+  EDT.curline_pos=p-EDT.gap_start;
+  EDT_BufMoveGapTo(EDT.gap_end+EDT.curline_pos);
+}
+
+/* Put the cursor at the gap after it was moved by a block operation
+   and redraw the screen. row is the screen row of the line, 127 to put
+   it in the centre. */
+static void EDT_CursorToGap(int row)
+{
+  EDT_CursorAt(EDT.gap_start);
+  EDT.cursor_row = row < 0 ? 127 : row;
+  EDT_AdjustTop(true);
+}
+
 static void EDT_CutLine(bool fContinue)
 {
   if (!fContinue) {
     EDT.cut_end = EDT.text_end;
     EDT.cut_lines = 0;
+    EDT.cut_block = 0;
+    EDT_FilesOwnCut();
   }
   EDT_BufStartLine();
   EDT.curline_pos=0;
@@ -162,6 +188,8 @@ static void EDT_CopyLine(bool fContinue)
   if (!fContinue) {
     EDT.cut_end = EDT.text_end;
     EDT.cut_lines = 0;
+    EDT.cut_block = 0;
+    EDT_FilesOwnCut();
   }
   EDT_BufStartLine();
   EDT.curline_pos=0;
@@ -178,8 +206,88 @@ static void EDT_CopyLine(bool fContinue)
   }
 }
 
+/* Set the mark at the cursor, or clear it if it is set. */
+static void EDT_SetMark(void)
+{
+  EDT.mark_set = !EDT.mark_set;
+  EDT.mark_pos = EDT.gap_start - EDT.text_start;
+  EDT_ShowBottom();
+  EDT_ShowCursor();
+}
+
+/* Move the gap to the start of the block from the mark to the cursor
+   and return the length of the block. */
+static unsigned int EDT_MarkedBlock(void)
+{
+  unsigned int cur = EDT.gap_start - EDT.text_start;
+  unsigned int end = cur + (EDT.text_end - EDT.gap_end) - 1;
+  unsigned int mark = EDT.mark_pos < end ? EDT.mark_pos : end;
+  if (mark >= cur)
+    return mark - cur;
+  EDT_BufGotoOffset(mark);
+  return cur - mark;
+}
+
+/* Cut or copy the block from the mark to the cursor to the cut buffer,
+   in a single move. */
+static void EDT_CutBlock(bool cut)
+{
+  unsigned int cur = EDT.gap_start - EDT.text_start;
+  unsigned int lineno = EDT.lineno;
+  unsigned int n = EDT_MarkedBlock();
+  if ((unsigned int)(EDT.mem_end - EDT.text_end) < n) {
+    /* Keep the cut buffer and the mark */
+    EDT_BufGotoOffset(cur);
+    EDT_SetCursor(0,EDT.scr_rows-1);
+    printf("Block too large to cut");
+    EDT_ClrEOL();
+    EDT_RenderCurrentLine();
+    return;
+  }
+  EDT.mark_set = 0;
+  EDT.cut_end = EDT.text_end;
+  EDT.cut_lines = 0;
+  EDT.cut_block = 1;
+  EDT_FilesOwnCut();
+  EDT_BufCopyBlock(n); /* Cannot fail, the whole cut area is free */
+  if (cut)
+    EDT_BufDeleteBlock(n);
+  else
+    EDT_BufGotoOffset(cur);
+  EDT_CursorToGap(EDT.cursor_row - (int)(lineno - EDT.lineno));
+}
+
+/* Write the block from the mark to the cursor to a file. The mark is
+   kept, so the block can still be cut afterwards. */
+static void EDT_WriteMarked(void)
+{
+  unsigned int cur = EDT.gap_start - EDT.text_start;
+  unsigned int n;
+  bool ok;
+  EDT_SetCursor(0,EDT.scr_rows-1);
+  EDT_ClrEOL();
+  EDT_SetCursor(0,EDT.scr_rows-1);
+  printf("Write block: ");
+  EDT.mem_start[BACKFILENAME_OFFS]=0;
+  EDT_ReadLine(EDT.mem_start+BACKFILENAME_OFFS,MAX_NAME_LENGTH,false);
+  n = EDT_MarkedBlock();
+  ok = EDT_WriteBlock(EDT.mem_start+BACKFILENAME_OFFS, EDT.gap_end, n);
+  EDT_BufGotoOffset(cur);
+  EDT_SetCursor(0,EDT.scr_rows-1);
+  printf(ok ? "Block written" : "Block write failed!");
+  EDT_ClrEOL();
+  EDT_RenderCurrentLine();
+}
+
 static void EDT_Paste(void)
 {
+  EDT_FilesTakeCut();
+  if (EDT.cut_block) {
+    /* Insert the block at the cursor */
+    EDT_BufPaste();
+    EDT_CursorToGap(127);
+    return;
+  }
   EDT_BufStartLine();
   EDT.curline_pos=0;
   EDT.cursor_col_max=0;
@@ -199,101 +307,180 @@ static void EDT_CenterScreen(void)
 static bool EDT_AskSave(void)
 {
   printf("Save file: ");
-  EDT_ReadLine(EDT.mem_start+FILENAME_OFFS,MAX_NAME_LENGTH);
+  EDT_ReadLine(EDT.mem_start+FILENAME_OFFS,MAX_NAME_LENGTH,false);
   return EDT_SaveFile(EDT.mem_start+FILENAME_OFFS);
 }
 
+/* Put the cursor on line n of the whole text. In paged mode the window
+   is moved to the line first. */
+static void EDT_GotoAbsLine(int n)
+{
+  while ((unsigned int)n > EDT.lines_before+EDT.total_lines &&
+	 EDT_PageForward())
+    ;
+  while ((unsigned int)n <= EDT.lines_before && EDT_PageBackward())
+    ;
+  n -= EDT.lines_before;
+  if (n<1) n=1;
+  if (n>EDT.total_lines) n=EDT.total_lines;
+  if (n!=EDT.lineno) {
+    EDT_BufGotoLine(n);
+    EDT_BufAdjustCol();
+  }
+  EDT.lineno=n;
+}
+
 static void EDT_GotoLine(void)
 {
-  int i,n;
+  int n;
   EDT.mem_start[LINENOSTRING_OFFS]=0;
   EDT_SetCursor(0,EDT.scr_rows-1);
   EDT_ClrEOL();
   EDT_SetCursor(0,EDT.scr_rows-1);
   printf("Goto line: ");
-  EDT_ReadLine(EDT.mem_start+LINENOSTRING_OFFS,4);
+  EDT_ReadLine(EDT.mem_start+LINENOSTRING_OFFS,7,false);
   n=atoi((char*)EDT.mem_start+LINENOSTRING_OFFS);
   if (n<1) n=1;
-  if (n>EDT.total_lines) n=EDT.total_lines;
-  if (n<EDT.lineno) {
-    for (i=0; i<EDT.lineno-n; i++) {
-      EDT_BufPrevLine();
-    }
-    EDT_BufAdjustCol();
-  } else if (n>EDT.lineno) {
-    for (i=0; i<n-EDT.lineno; i++) {
-      EDT_BufNextLine();
-    }
-    EDT_BufAdjustCol();
-  }
-  EDT.lineno=n;
+  EDT_GotoAbsLine(n);
   EDT.cursor_row=127;
   EDT_AdjustTop(false);
 }
 
 static void EDT_PageUp(void)
 {
-  int i;
   int n=EDT.scr_rows -2;
   EDT_LeaveCurrentLine();
-  for (i=0; i<n;i++) {
-    if (EDT.lineno==1) break;
-    EDT.lineno--;
-    EDT.cursor_row--;
-    EDT_BufPrevLine();
+  if (n > EDT.lineno-1)
+    n = EDT.lineno-1;
+  if (n>0) {
+    EDT.lineno -= n;
+    EDT.cursor_row -= n;
+    EDT_BufGotoLine(EDT.lineno);
+    EDT_BufAdjustCol();
   }
-  if (i>0)EDT_BufAdjustCol();
   EDT_AdjustTop(false);
 }
 
 static void EDT_PageDown(void)
 {
-  int i;
   int n=EDT.scr_rows -2;
   EDT_LeaveCurrentLine();
-  for (i=0; i<n;i++) {
-    if (EDT.lineno ==EDT.total_lines) break;
-    EDT.lineno++;
-    EDT.cursor_row++;
-    EDT_BufNextLine();
+  if (n > EDT.total_lines-EDT.lineno)
+    n = EDT.total_lines-EDT.lineno;
+  if (n>0) {
+    EDT.lineno += n;
+    EDT.cursor_row += n;
+    EDT_BufGotoLine(EDT.lineno);
+    EDT_BufAdjustCol();
   }
-  if (i>0)EDT_BufAdjustCol();
   EDT_AdjustTop(false);
 }
 
-static void EDT_SearchF(void)
+static bool search_forward = true;
+
+/* Ask for the search string. TAB toggles between exact and case
+   insensitive search. */
+static void EDT_SearchPrompt(char *prompt)
+{
+  for (;;) {
+    EDT_SetCursor(0,EDT.scr_rows-1);
+    EDT_ClrEOL();
+    EDT_SetCursor(0,EDT.scr_rows-1);
+    printf(EDT.ignore_case ? "%s (ignore case): " : "%s: ",prompt);
+    if (EDT_ReadLine(EDT.mem_start+SEARCHSTRING_OFFS,SEARCH_LENGTH,true) != 9)
+      break;
+    EDT.ignore_case = !EDT.ignore_case;
+  }
+}
+
+/* Line and column of the cursor in the whole text before a search. */
+static unsigned int find_line;
+static unsigned int find_col;
+static unsigned int find_col_max;
+
+static void EDT_FindSave(void)
+{
+  find_line = EDT.lines_before+EDT.lineno;
+  find_col = EDT.cursor_col;
+  find_col_max = EDT.cursor_col_max;
+}
+
+/* Nothing was found. In paged mode the search may have moved the window,
+   put the cursor back where it was. */
+static void EDT_FindRestore(void)
+{
+  if (!EDT.paged || EDT.lines_before+EDT.lineno == find_line)
+    return;
+  EDT_GotoAbsLine(find_line);
+  EDT_BufStartLine();
+  EDT.curline_pos=0;
+  EDT.cursor_col=find_col;
+  EDT.cursor_col_max=find_col_max;
+  EDT_BufAdjustCol();
+  EDT.cursor_row=127;
+  EDT_AdjustTop(true);
+}
+
+/* Find the search string from address p after the gap, in paged mode
+   also in the text after the window. */
+static unsigned char *EDT_FindForward(unsigned char *pat, unsigned int len,
+				      unsigned char *p)
+{
+  if (len == 0)
+    return NULL;
+  EDT_FindSave();
+  p = EDT_BufFindF(pat,len,p);
+  while (p == NULL && EDT_PageForward())
+    p = EDT_BufFindF(pat,len,EDT.gap_end);
+  if (p == NULL)
+    EDT_FindRestore();
+  return p;
+}
+
+/* Find the search string before the cursor, in paged mode also in the
+   text before the window. */
+static unsigned char *EDT_FindBackward(unsigned char *pat, unsigned int len)
+{
+  unsigned char *p;
+  if (len == 0)
+    return NULL;
+  EDT_FindSave();
+  p = EDT_BufFindB(pat,len);
+  while (p == NULL && EDT_PageBackward())
+    p = EDT_BufFindB(pat,len);
+  if (p == NULL)
+    EDT_FindRestore();
+  return p;
+}
+
+/* Search forward or backward, ask for the search string if prompt is set
+   or if there is no previous one. */
+static void EDT_Search(bool forward, bool prompt)
 {
-  unsigned int lines_fwd=0;
+  unsigned char *pat = EDT.mem_start+SEARCHSTRING_OFFS;
   unsigned int srch_len;
-  unsigned char *p = EDT.gap_end+1;
-  EDT_SetCursor(0,EDT.scr_rows-1);
-  EDT_ClrEOL();
-  EDT_SetCursor(0,EDT.scr_rows-1);
-  printf("Find: ");
-  EDT_ReadLine(EDT.mem_start+SEARCHSTRING_OFFS,MAX_NAME_LENGTH);
-  srch_len = strlen((char*)EDT.mem_start+SEARCHSTRING_OFFS);
-  if (srch_len>0) {
-    while (EDT.text_end - p >= srch_len) {
-      if (memcmp(p,EDT.mem_start+SEARCHSTRING_OFFS,srch_len)==0) {
-	/* Found it! */
-	while (p != EDT.gap_end) {
-	  EDT_BufNextChar();
-	}
-	EDT_BufStartLine();
-	EDT.cursor_col=0;
-	EDT.cursor_col_max=0;
-	EDT_BufAdjustCol();
-	EDT.curline_pos=p-EDT.gap_end;
-	while (p != EDT.gap_end) {
-	  EDT_BufNextChar();
-	}
-	EDT.lineno+=lines_fwd;
-	EDT.cursor_row=127;
-	EDT_AdjustTop(true);
-	return;
-      }
-      if (*p++=='\n') lines_fwd++;
+  unsigned char *p = NULL;
+  if (prompt || pat[0] == 0)
+    EDT_SearchPrompt("Find");
+  search_forward = forward;
+  srch_len = strlen((char*)pat);
+  if (forward) {
+    p = EDT_FindForward(pat,srch_len,EDT.gap_end+1);
+    if (p != NULL) {
+      /* Found it! */
+      EDT_CursorAt(p);
     }
+  } else {
+    p = EDT_FindBackward(pat,srch_len);
+    if (p != NULL) {
+      /* Found it! */
+      EDT_CursorAt(p);
+    }
+  }
+  if (p != NULL) {
+    EDT.cursor_row=127;
+    EDT_AdjustTop(true);
+    return;
   }
   /* Got here, not found */
   EDT_SetCursor(0,EDT.scr_rows-1);
@@ -302,65 +489,126 @@ static void EDT_SearchF(void)
   EDT_RenderCurrentLine();
 }
 
-static void EDT_SearchB(void)
+/* Replace the search string by the replacement string, from the cursor
+   to the end of the text. Each match is shown and can be replaced (y),
+   skipped (n) or all remaining matches can be replaced at once (a).
+*/
+static void EDT_Replace(void)
 {
-  unsigned int lines_bwd=0;
-  unsigned int srch_len;
-  unsigned char *p = EDT.gap_start-1;
-  EDT_SetCursor(0,EDT.scr_rows-1);
-  EDT_ClrEOL();
-  EDT_SetCursor(0,EDT.scr_rows-1);
-  printf("Find: ");
-  EDT_ReadLine(EDT.mem_start+SEARCHSTRING_OFFS,MAX_NAME_LENGTH);
-  srch_len = strlen((char*)EDT.mem_start+SEARCHSTRING_OFFS);
-  if (srch_len>0) {
-    while (p > EDT.text_start) {
-      if (memcmp(p,EDT.mem_start+SEARCHSTRING_OFFS,srch_len)==0) {
-	/* Found it! */
-	while (p != EDT.gap_start) {
-	  EDT_BufPrevChar();
-	}
-	EDT_BufStartLine();
-	EDT.cursor_col=0;
-	EDT.cursor_col_max=0;
-	EDT_BufAdjustCol();
-	EDT.curline_pos=p-EDT.gap_start;
-	while (p != EDT.gap_start) {
-	  EDT_BufNextChar();
-	}
-	EDT.lineno-=lines_bwd;
-	EDT.cursor_row=127;
-	EDT_AdjustTop(true);
-	return;
+  unsigned char *pat = EDT.mem_start+SEARCHSTRING_OFFS;
+  unsigned char *rep = EDT.mem_start+REPLACESTRING_OFFS;
+  unsigned int srch_len,rep_len;
+  unsigned int count=0;
+  unsigned char *p;
+  int k;
+  bool ok = true;
+  EDT_SearchPrompt("Replace");
+  srch_len = strlen((char*)pat);
+  if (srch_len > 0) {
+    EDT_SetCursor(0,EDT.scr_rows-1);
+    EDT_ClrEOL();
+    EDT_SetCursor(0,EDT.scr_rows-1);
+    printf("With: ");
+    EDT_ReadLine(rep,SEARCH_LENGTH,false);
+  }
+  rep_len = strlen((char*)rep);
+  p = EDT_FindForward(pat,srch_len,EDT.gap_end);
+  while (p != NULL) {
+    EDT_CursorAt(p);
+    EDT.cursor_row=127;
+    EDT_AdjustTop(true);
+    EDT_SetCursor(0,EDT.scr_rows-1);
+    printf("Replace? (Y)es, (N)o, (A)ll, ESC to stop");
+    EDT_ClrEOL();
+    EDT_RenderCurrentLine();
+    k = EDT_GetKey();
+    if (k == 'a' || k == 'A') {
+      ok = EDT_BufReplaceAll(pat,srch_len,rep,rep_len,&count);
+      while (ok && EDT_PageForward())
+	ok = EDT_BufReplaceAll(pat,srch_len,rep,rep_len,&count);
+      EDT_CursorAt(EDT.gap_end);
+      break;
+    } else if (k == 'y' || k == 'Y') {
+      if (!EDT_BufReplace(srch_len,rep,rep_len)) {
+	ok = false;
+	break;
       }
-      if (*p--=='\n') lines_bwd++;
+      count++;
+      p = EDT_FindForward(pat,srch_len,EDT.gap_end);
+    } else if (k == 'n' || k == 'N') {
+      p = EDT_FindForward(pat,srch_len,EDT.gap_end+1);
+    } else {
+      break;
     }
   }
-  /* Got here, not found */
+  EDT.cursor_row=127;
+  EDT_AdjustTop(true);
   EDT_SetCursor(0,EDT.scr_rows-1);
-  printf("Not found!");
+  printf(ok ? "Replaced %u" : "Replaced %u, out of memory",count);
   EDT_ClrEOL();
   EDT_RenderCurrentLine();
 }
 
+/* Open the file named at BACKFILENAME_OFFS in a new buffer. */
+static void EDT_OpenFile(void)
+{
+  if (!EDT_FilesOpen(EDT.mem_start+BACKFILENAME_OFFS)) {
+    EDT_SetCursor(0,EDT.scr_rows-1);
+    printf("Not enough memory to open file");
+    EDT_ClrEOL();
+    EDT_RenderCurrentLine();
+    return;
+  }
+  EDT_ShowScreen();
+}
+
+static void EDT_NextFile(void)
+{
+  if (!EDT_FilesNext()) {
+    EDT_SetCursor(0,EDT.scr_rows-1);
+    printf("No other files open");
+    EDT_ClrEOL();
+    EDT_RenderCurrentLine();
+    return;
+  }
+  EDT_ShowScreen();
+}
+
+/* Read a file and insert it before the current line. TAB at the prompt
+   toggles to opening the file in a new buffer instead. */
 static void EDT_ReadFile(void)
 {
   unsigned int old_lines = EDT.total_lines;
-  unsigned int added_lines,i;
+  unsigned int added_lines;
+  unsigned char *old_end;
+  bool open_file = false;
+  EDT.mem_start[BACKFILENAME_OFFS]=0;
+  for (;;) {
+    EDT_SetCursor(0,EDT.scr_rows-1);
+    EDT_ClrEOL();
+    EDT_SetCursor(0,EDT.scr_rows-1);
+    printf(open_file ? "Open file: " : "Read file: ");
+    if (EDT_ReadLine(EDT.mem_start+BACKFILENAME_OFFS,MAX_NAME_LENGTH,true)
+	!= 9)
+      break;
+    open_file = !open_file;
+  }
+  if (open_file) {
+    EDT_OpenFile();
+    return;
+  }
   EDT_BufStartLine();
   EDT.curline_pos=0;
   EDT.cursor_col_max=0;
-  EDT_SetCursor(0,EDT.scr_rows-1);
-  EDT_ClrEOL();
-  EDT_SetCursor(0,EDT.scr_rows-1);
-  printf("Read file: ");
-  EDT.mem_start[BACKFILENAME_OFFS]=0;
-  EDT_ReadLine(EDT.mem_start+BACKFILENAME_OFFS,MAX_NAME_LENGTH);
+  EDT_BufChanged();
+  old_end = EDT.gap_end;
   EDT_LoadFile(EDT.mem_start+BACKFILENAME_OFFS);
+  EDT_UndoRecord(false, EDT.gap_start - EDT.text_start, EDT.gap_end,
+		 old_end - EDT.gap_end, false);
   added_lines = EDT.total_lines - old_lines;
-  for (i=0; i<added_lines; i++) {
-    EDT_BufNextLine();
-    EDT.lineno++;
+  if (added_lines > 0) {
+    EDT.lineno += added_lines;
+    EDT_BufGotoLine(EDT.lineno);
   }
   EDT.is_changed=1;
   EDT.cursor_row=127;
@@ -368,6 +616,24 @@ static void EDT_ReadFile(void)
   EDT_AdjustTop(true);
 }
 
+/* Undo the last command or redo the last undone one. */
+static void EDT_UndoRedo(bool redo)
+{
+  bool none = redo ? EDT.undo_pos == EDT.undo_end
+		   : EDT.undo_pos == EDT.undo_start;
+  if (redo ? !EDT_Redo() : !EDT_Undo()) {
+    EDT_SetCursor(0,EDT.scr_rows-1);
+    if (none)
+      printf(redo ? "Nothing to redo" : "Nothing to undo");
+    else
+      printf("Not enough memory to %s", redo ? "redo" : "undo");
+    EDT_ClrEOL();
+    EDT_RenderCurrentLine();
+    return;
+  }
+  EDT_CursorToGap(127);
+}
+
 /* Read 2 keypresses and treat them as hex digits. Insert the corresponding
    character */
 static void EDT_InsertHex(void)
@@ -400,15 +666,24 @@ static unsigned int EDT_NextWordLength()
 static void EDT_Justify(void)
 {
   unsigned char *ret_p = EDT.gap_end;
+  unsigned char *p = EDT.gap_start;
   unsigned int cur_len = 0;
   bool crossed_cursor = false;
   unsigned int state = EDT_JUSTIFY_SPACE;
   /* Find start of paragraph */
-  while (EDT.gap_start - EDT.text_start > 2 &&
-	 (EDT.gap_start[-1] != '\n' || EDT.gap_start[-2] != '\n')) {
-    if (EDT.gap_end[0] == '\n' && ret_p != EDT.gap_end) EDT.lineno--;
-    EDT_BufPrevChar();
+  while (p - EDT.text_start > 2 &&
+	 (p[-1] != '\n' || p[-2] != '\n')) {
+    if (*--p == '\n') EDT.lineno--;
   }
+  EDT_BufMoveGapTo(p);
+  EDT_BufChanged();
+  /* Keep the old paragraph in the undo journal */
+  p = EDT.gap_end;
+  while (p < EDT.text_end - 2 && (p[0] != '\n' || p[1] != '\n'))
+    p++;
+  EDT_UndoRecord(true, EDT.gap_start - EDT.text_start, EDT.gap_end,
+		 p - EDT.gap_end, false);
+  p = EDT.gap_start;
   /* Reformat paragraph */
   while (EDT.gap_end < EDT.text_end - 2 &&
 	 (EDT.gap_end[0] != '\n' || EDT.gap_end[1] != '\n')) {
@@ -418,8 +693,16 @@ static void EDT_Justify(void)
     }
     if (state == EDT_JUSTIFY_WORD) {
       if (EDT.gap_end[0] > ' ') {
-	EDT_BufNextChar();
-	cur_len++;
+	/* Copy the whole word at once */
+	unsigned int wlen = EDT_NextWordLength();
+	if (wlen > (unsigned int)(EDT.text_end - 2 - EDT.gap_end))
+	  wlen = EDT.text_end - 2 - EDT.gap_end;
+	if (!crossed_cursor && ret_p < EDT.gap_end + wlen) {
+	  crossed_cursor = true;
+	  ret_p = EDT.gap_start + (ret_p - EDT.gap_end);
+	}
+	EDT_BufMoveGapTo(EDT.gap_end + wlen);
+	cur_len += wlen;
       } else {
 	state = EDT_JUSTIFY_SPACE;
       }
@@ -448,64 +731,59 @@ static void EDT_Justify(void)
       }
     }
   }
+  EDT_UndoRecord(false, p - EDT.text_start, p, EDT.gap_start - p, false);
   if (crossed_cursor) {
     /* Return to the original character */
-    while (EDT.gap_start != ret_p) {
-      EDT_BufPrevChar();
-    }
+    EDT_BufMoveGapTo(ret_p);
   } else {
     ret_p = EDT.gap_start;
   }
   /* Reposition cursor */
   EDT.is_changed=1;
-  EDT_BufStartLine();
-  EDT.cursor_col=0;
-  EDT.cursor_col_max=0;
-  EDT_BufAdjustCol();
-  EDT.curline_pos=ret_p-EDT.gap_start;
-  while (ret_p != EDT.gap_start) {
-    EDT_BufNextChar();
-  }
+  EDT_CursorAt(ret_p);
   EDT.cursor_row=127;
   EDT_AdjustTop(true);
 }
 
 static char HelpText[] =
   "Nano Extended for Agon v0.20, Copyright 2025, L.C. Benschop\r\n"
-  "\r\n"
   "Cursor movement:\r\n"
   "Ctrl-B or cursor left, Ctrl-F or cursor right\r\n"
   "Ctrl-P or cursor up, Ctrl-N or cursor down\r\n"
-  "Ctrl-Y: page up, Ctrl-V: page down\r\n"
-  "Ctrl-A; start of line, Ctrl-E: end of line\r\n"
+  "Ctrl-Y: page up, Ctrl-V: page down, "
+  "Ctrl-A: start of line, Ctrl-E: end of line\r\n"
   "Ctrl-L, redraw screen with current line in centre\r\n"
   "Ctrl-H goto line (enter number)\r\n"
   "\r\n"
-  "Delete:\r\n"
+  "Delete and undo:\r\n"
   "Backspace: delete to left, Control-D: delete to right\r\n"
+  "Ctrl-Z: undo, Ctrl-]: redo\r\n"
   "\r\n"
   "Cut and paste:\r\n"
   "Ctrl-K cut current line, repeat to cut block of multiple lines\r\n"
   "Ctrl-C copy current line, repeat to copy block of multiple lines\r\n"
+  "Ctrl-^ set/clear mark, then Ctrl-K/Ctrl-C cut/copy from mark to cursor\r\n"
   "Ctrl-U paste cut/copied lines, can be repeated to paste multiple times\r\n"
   "\r\n"
   "Find:\r\n"
-  "Ctrl-W: find forward, Ctrl-Q: find backward\r\n"
+  "Ctrl-W: find forward, Ctrl-Q: find backward, Ctrl-S: find next\r\n"
+  "TAB at the Find prompt toggles case insensitive search\r\n"
+  "Ctrl-\\: replace, confirm each (y/n) or replace all (a)\r\n"
   "\r\n"
   "Other:\r\n"
-  "Ctrl-R: insert file before current line, Ctrl-O to save file\r\n"
-  "Ctrl-X or ESC: Exit editor (ask to save) Ctrl-J Justify paragraph\r\n"
+  "Ctrl-R: insert file before current line, TAB at prompt: open in new buffer\r\n"
+  "Ctrl-_: next buffer, Ctrl-O to save file or block, Ctrl-J Justify paragraph\r\n"
+  "Ctrl-X or ESC: close buffer, exit editor after the last (ask to save)\r\n"
   "Ctrl-T followed by two hex digits: insert special character\r\n"
   "\r\n"
   "Press any key to return to editor.";
 
 static void EDT_ShowHelp(void)
 {
-  char *p=HelpText;
   putch(12);
-  while (*p)
-    putch(*p++);
+  mos_puts(HelpText, strlen(HelpText), 0);
   EDT_GetKey();
+  EDT_InvalidateScreen();
   EDT_ShowScreen();
 }
 
@@ -524,6 +802,7 @@ void EDT_EditCore(void)
   EDT.cut_end = EDT.text_end;
   EDT.tab_stop = 8;
   EDT.crlf_flag = 0;
+  EDT.ignore_case = 0;
   EDT.scr_rows = 30;
   EDT.cursor_row = 0;
   EDT.cursor_col = 0;
@@ -531,18 +810,24 @@ void EDT_EditCore(void)
   EDT.curline_pos = 0;
   EDT.is_changed = 0;
   EDT.mem_start[SEARCHSTRING_OFFS]=0;
+  EDT.mem_start[REPLACESTRING_OFFS]=0;
   EDT.total_lines = 0;
   EDT.cut_lines = 0;
+  EDT.cut_block = 0;
+  EDT.mark_set = 0;
+  EDT.paged = 0;
+  EDT.lines_before = 0;
+  EDT.lines_after = 0;
+  EDT_SyntaxInit();
   EDT_LoadConfig("/bin/ne.cfg");
 
   EDT_InitScreen();
-  EDT_LoadFile(EDT.mem_start+FILENAME_OFFS);
-  EDT.top_line = EDT.gap_start;
-  EDT.curline_len=EDT_BufLenCurLine();
-  EDT.lineno = 1;
+  EDT_FilesInit();
   EDT_ShowScreen();
   for(;;){
     int k = EDT_GetKey();
+    bool marked = EDT.mark_set;
+    EDT_UndoBegin();
     switch (k) {
     case 1:
     case 0x100+VKEY_HOME:
@@ -553,8 +838,13 @@ void EDT_EditCore(void)
       EDT_CursorLeft();
       break;
     case 3:
-      EDT_CopyLine(fCutContinue);
-      fCutContinue = true;
+      if (EDT.mark_set) {
+	EDT_CutBlock(false);
+	fCutContinue = false;
+      } else {
+	EDT_CopyLine(fCutContinue);
+	fCutContinue = true;
+      }
       break;
     case 4:
     case 0x100+VKEY_DELETE:
@@ -581,8 +871,13 @@ void EDT_EditCore(void)
       EDT_Justify();
       break;
     case 11:
-      EDT_CutLine(fCutContinue);
-      fCutContinue = true;
+      if (EDT.mark_set) {
+	EDT_CutBlock(true);
+	fCutContinue = false;
+      } else {
+	EDT_CutLine(fCutContinue);
+	fCutContinue = true;
+      }
       break;
     case 12:
       EDT_CenterScreen();
@@ -595,6 +890,10 @@ void EDT_EditCore(void)
       EDT_CursorDown();
       break;
     case 15:
+      if (EDT.mark_set) {
+	EDT_WriteMarked();
+	break;
+      }
       EDT_SetCursor(0,EDT.scr_rows-1);
       EDT_ClrEOL();
       EDT_SetCursor(0,EDT.scr_rows-1);
@@ -612,11 +911,14 @@ void EDT_EditCore(void)
       EDT_CursorUp();
       break;
     case 17:
-      EDT_SearchB();
+      EDT_Search(false,true);
       break;
     case 18:
       EDT_ReadFile();
       break;
+    case 19:
+      EDT_Search(search_forward,false);
+      break;
     case 20:
       EDT_InsertHex();
       break;
@@ -628,7 +930,7 @@ void EDT_EditCore(void)
       EDT_PageDown();
       break;
     case 23:
-      EDT_SearchF();
+      EDT_Search(true,true);
       break;
     case 24:
     case 27:
@@ -647,12 +949,32 @@ void EDT_EditCore(void)
 	  if (!success) printf("File save failed!\r\n");
 	} while (!success);
       }
+      EDT_PageClose();
+      if (EDT_FilesClose()) {
+	EDT_ShowScreen();
+	break;
+      }
       EDT_ExitScreen();
       return;
     case 25:
     case 0x100+VKEY_PAGEUP:
       EDT_PageUp();
       break;
+    case 26:
+      EDT_UndoRedo(false);
+      break;
+    case 28:
+      EDT_Replace();
+      break;
+    case 29:
+      EDT_UndoRedo(true);
+      break;
+    case 30:
+      EDT_SetMark();
+      break;
+    case 31:
+      EDT_NextFile();
+      break;
     case 127:
       EDT_BackSpace();
       break;
@@ -662,5 +984,11 @@ void EDT_EditCore(void)
     }
     if (k != 11 && k != 3)
       fCutContinue = false;
+    if (marked && !EDT.mark_set) {
+      /* The mark was used or an edit before it cleared it */
+      EDT_ShowBottom();
+      EDT_ShowCursor();
+    }
+    EDT_PageCheck();
   }
 }
@@ -8,50 +8,45 @@
 #include <stdio.h>
 #include "edit.h"
 
+/* Remove all control characters but LF and TAB from the n bytes at p.
+   Most files have none, so a fast scan looks for the first one before
+   any bytes are moved. Return the new length. */
+unsigned int EDT_FilterText(unsigned char *p, unsigned int n)
+{
+  unsigned char *end = p + n;
+  unsigned char *q;
+  unsigned char c;
+  while (p < end && ((*p >= 32 && *p != 127) || *p == '\n' || *p == '\t'))
+    p++;
+  q = p;
+  while (p < end) {
+    c = *p++;
+    if ((c >= 32 && c != 127) || c == '\n' || c == '\t')
+      *q++ = c;
+  }
+  return n - (p - q);
+}
+
+/* Read the file into the start of the gap, filter it and move it to the
+   end of the gap as one block. */
 void EDT_LoadFile(unsigned char* filename)
 {
   FILE *fp;
-  int len,curlinelen;
-  unsigned char *p;
+  unsigned int len;
   fp = fopen((char*)filename,"rb");
-  if(fp!=0) {    
-    len = fread(EDT.gap_start, 1,  EDT.gap_end-EDT.gap_start, fp);
+  if(fp!=0) {
+    /* Leave room for a newline at the end */
+    len = fread(EDT.gap_start, 1, EDT.gap_end-EDT.gap_start-1, fp);
     if (len>0) {
-      //printf("Read %d bytes\n",len);
-      p=EDT.gap_start + len;
-      if (*(p-1)!='\n') {
-	*--(EDT.gap_end) = '\n';
-      }
-      curlinelen=0;
-      while (p!=EDT.gap_start) {
-	char c=*--p;
-	if (EDT.gap_start == EDT.gap_end) {
-	  // No more room for file.
-	  break;
-	}
-	if (EDT.crlf_flag == 2 && c==13) EDT.crlf_flag = 1;
-	/* Mark file for saving in CR-LF mode. */
-	if (((unsigned)c>=32 && c!=127) || c=='\n' || c=='\t') {
-	  /* Filter all control chars but LF and TAB */
-	  if (c=='\n') {
-	    curlinelen = 0;
-	    EDT.total_lines++;
-	  } else {
-	    curlinelen++;
-	  }
-	  if (curlinelen==254) {
-	    /* Force lines to be at most 254 chars (excluding nl) */
-	    *--(EDT.gap_end) = '\n';
-	    EDT.total_lines++;
-	    if (EDT.gap_start == EDT.gap_end) {
-	      // No more room for file.
-	      break;
-	    }
-	    curlinelen=0;
-	  }
-	  *--(EDT.gap_end) = c;
-	}
-      }
+      /* Mark file for saving in CR-LF mode. */
+      if (EDT.crlf_flag == 2 && memchr(EDT.gap_start, 13, len) != NULL)
+	EDT.crlf_flag = 1;
+      len = EDT_FilterText(EDT.gap_start, len);
+      if (len > 0 && EDT.gap_start[len-1] != '\n')
+	EDT.gap_start[len++] = '\n';
+      EDT.gap_end -= len;
+      memmove(EDT.gap_end, EDT.gap_start, len);
+      EDT.total_lines += EDT_BufCountLines(EDT.gap_end, EDT.gap_end + len);
     }
     fclose(fp);
   }
@@ -62,51 +57,129 @@ void EDT_LoadFile(unsigned char* filename)
 }
 
 
-bool EDT_SaveFile(unsigned char* filename)
+/* Text in CR-LF mode is translated into save_buf, which is written
+   when it is full. */
+#define SAVE_BUF_SIZE 4096
+static unsigned char save_buf[SAVE_BUF_SIZE];
+static unsigned int save_filled;
+
+static bool EDT_SaveFlush(FILE *fp)
+{
+  unsigned int n = save_filled;
+  save_filled = 0;
+  return n == 0 || fwrite(save_buf, 1, n, fp) == n;
+}
+
+/* Write n bytes of text, with CR-LF line ends if the file is saved in
+   CR-LF mode. */
+bool EDT_WriteText(FILE *fp, unsigned char *p, unsigned int n)
+{
+  unsigned char *q;
+  unsigned int run, m;
+  if (EDT.crlf_flag != 1)
+    return EDT_SaveFlush(fp) && fwrite(p, 1, n, fp) == n;
+  while (n > 0) {
+    q = memchr(p, '\n', n);
+    run = q ? (unsigned int)(q - p) : n;
+    n -= run;
+    while (run > 0) {
+      m = SAVE_BUF_SIZE - save_filled;
+      if (m > run)
+	m = run;
+      memcpy(save_buf + save_filled, p, m);
+      save_filled += m;
+      p += m;
+      run -= m;
+      if (save_filled == SAVE_BUF_SIZE && !EDT_SaveFlush(fp))
+	return false;
+    }
+    if (q != NULL) {
+      if (save_filled > SAVE_BUF_SIZE - 2 && !EDT_SaveFlush(fp))
+	return false;
+      save_buf[save_filled++] = '\r';
+      save_buf[save_filled++] = '\n';
+      p++;
+      n--;
+    }
+  }
+  return true;
+}
+
+/* Replace the extension of name by ext (at most 4 characters) in buf.
+   Return false if the name is too long. */
+static bool EDT_ChangeExt(char *buf, char *name, char *ext)
 {
-  FILE *fp;
   char *p;
-  /* Create backup file name */
-  strcpy((char*)EDT.mem_start+BACKFILENAME_OFFS,(char*)filename);
-  p = strrchr((char*)EDT.mem_start+BACKFILENAME_OFFS, '.');
+  strcpy(buf, name);
+  p = strrchr(buf, '.');
   if (!p) {
-    p=(char*)EDT.mem_start+BACKFILENAME_OFFS;
+    p=buf;
     p+=strlen(p);
   }
-  if (p-(char*)(EDT.mem_start+BACKFILENAME_OFFS) > MAX_NAME_LENGTH-4)
+  if (p-buf > MAX_NAME_LENGTH-4)
+    return false;
+  strcpy(p, ext);
+  return true;
+}
+
+/* Save the text. It is written to a temporary file first, which replaces
+   the file when it is complete. The old file becomes the backup file. */
+bool EDT_SaveFile(unsigned char* filename)
+{
+  FILE *fp;
+  char *back = (char*)EDT.mem_start+BACKFILENAME_OFFS;
+  char tmpname[MAX_NAME_LENGTH+1];
+  bool ok;
+  long pos;
+  if (!EDT_ChangeExt(back, (char*)filename, ".bak") ||
+      !EDT_ChangeExt(tmpname, (char*)filename, ".$$$"))
     return false;
-  strcpy(p,".bak");
-  /* Delete old backup file, this may fail, don't care */
-  mos_del((char*)EDT.mem_start+BACKFILENAME_OFFS);
-  /* Rename current file into backup file, this may fail, don't care  */
-  mos_ren((char*)filename, (char*)EDT.mem_start+BACKFILENAME_OFFS);
-  /* Create file to save */
-  fp = fopen((char*)filename,"wb");
+  if (strcmp(tmpname, (char*)filename) == 0)
+    strcpy(tmpname + strlen(tmpname) - 4, ".$$_");
+  fp = fopen(tmpname,"wb");
   if (fp==0) return false;
-  if (EDT.crlf_flag != 1) {
-    if (EDT.gap_start > EDT.text_start) {
-      fwrite(EDT.text_start,EDT.gap_start - EDT.text_start,1,fp);
-    }
-    if (EDT.text_end > EDT.gap_end) {
-      fwrite(EDT.gap_end, EDT.text_end - EDT.gap_end,1,fp);
+  save_filled = 0;
+  ok = EDT_PageWriteHead(fp) &&
+    EDT_WriteText(fp, EDT.text_start, EDT.gap_start - EDT.text_start) &&
+    EDT_WriteText(fp, EDT.gap_end, EDT.text_end - EDT.gap_end) &&
+    EDT_SaveFlush(fp);
+  pos = ftell(fp);
+  ok = ok && EDT_PageWriteTail(fp) && EDT_SaveFlush(fp);
+  ok = fclose(fp) == 0 && ok;
+  if (!ok) {
+    mos_del(tmpname);
+    return false;
+  }
+  if (EDT.paged) {
+    /* The text after the window may be read from the file */
+    if (!EDT_PageBackup((char*)filename, back)) {
+      mos_del(tmpname);
+      return false;
     }
   } else {
-    unsigned char *p;
-    for (p=EDT.text_start; p<EDT.gap_start; p++) {
-      if (*p=='\n')
-	fwrite("\r",1,1,fp);
-      fwrite(p,1,1,fp);
-    }
-    for (p=EDT.gap_end; p<EDT.text_end; p++) {
-      if (*p=='\n')
-	fwrite("\r",1,1,fp);
-      fwrite(p,1,1,fp);
-    }
+    /* Delete old backup file, this may fail, don't care */
+    mos_del(back);
+    /* Rename current file into backup file, this may fail, don't care  */
+    mos_ren((char*)filename, back);
   }
-  fclose(fp);
+  if (mos_ren(tmpname, (char*)filename) != 0)
+    return false;
+  EDT_PageSaved((char*)filename, pos);
   return true;
 }
 
+/* Write the block of n bytes at p to a file. */
+bool EDT_WriteBlock(unsigned char *name, unsigned char *p, unsigned int n)
+{
+  FILE *fp;
+  bool ok;
+  fp = fopen((char*)name,"wb");
+  if (fp==0) return false;
+  save_filled = 0;
+  ok = EDT_WriteText(fp, p, n) && EDT_SaveFlush(fp);
+  return fclose(fp) == 0 && ok;
+}
+
 /* Replacement for fgets as the one in AgDev appears to be broken,
    does not detect EOF on real machine */
 static char * my_fgets(char *s, unsigned int maxlen, FILE *f)
@@ -146,13 +219,14 @@ parse_word(unsigned char *p)
 void EDT_LoadConfig(char *name)
 {
   FILE *fp;
-  unsigned char *p,*q;
+  unsigned char *p,*q,*r,*end;
   fp = fopen(name,"rb");
   if(fp!=0) {    
     while (my_fgets((char*)EDT.text_start, 81, fp)) {
       if (EDT.text_start[0]=='\n' || EDT.text_start[0]=='#') continue;
       /* skip blank lines. */
       p=EDT.text_start;
+      end=p+strlen((char*)p);
       p=parse_word(p);
       q=p+strlen((char*)p)+1;
       q=parse_word(q);
@@ -177,6 +251,29 @@ void EDT_LoadConfig(char *name)
 	} else if (strcmp((char*)q,"lf") == 0) {
 	  EDT.crlf_flag = 0;
 	}
+      } else if (strcmp((char*)p,"case") == 0) {
+	if (strcmp((char*)q,"ignore") == 0) {
+	  EDT.ignore_case = 1;
+	} else if (strcmp((char*)q,"exact") == 0) {
+	  EDT.ignore_case = 0;
+	}
+      } else if (strcmp((char*)p,"highlight") == 0) {
+	if (strcmp((char*)q,"on") == 0) {
+	  EDT.highlight = 1;
+	} else if (strcmp((char*)q,"off") == 0) {
+	  EDT.highlight = 0;
+	}
+      } else if (strcmp((char*)p,"colour") == 0) {
+	r=q+strlen((char*)q)+1;
+	if (r <= end)
+	  EDT_SyntaxColour(q, parse_word(r));
+      } else if (strcmp((char*)p,"keywords") == 0) {
+	/* All words after the language name */
+	for (r=q+strlen((char*)q)+1; r <= end; r+=strlen((char*)r)+1) {
+	  r=parse_word(r);
+	  if (*r==0) break;
+	  EDT_SyntaxKeyword(q, r);
+	}
       }
     }
     //EDT_GetKey();
@@ -0,0 +1,218 @@
+/* Nano-style editor
+   Copyright 2025, L.C. Benschop, Vught, The Netherlands.
+   MIT license
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include "edit.h"
+
+/* Several open files. Each file has its own region of the memory area,
+   from its mem_start to its mem_end, laid out like the whole area is for
+   a single file: variables, text with the gap, cut buffer and undo
+   journal. The state of the file being edited is in EDT, the states of
+   the other files are kept in files[].
+
+   Opening a file takes the memory from the top of the region of the
+   active file, closing a file gives its region to the file next to it.
+   Only the first file can be edited in paged mode, others must fit in
+   memory. There is one cut buffer for all files, it is copied to the
+   file that pastes it.
+*/
+#define MAX_FILES 8
+#define FILES_SLACK 1024  /* Free space of a newly opened file */
+
+static struct _EditState files[MAX_FILES];
+static struct _EditState files_init; /* State with the settings */
+static int n_files;
+static int cur_file;
+static int cut_owner;   /* File whose cut buffer holds the last cut */
+
+/* Set up the region from EDT.mem_start to EDT.mem_end for the file named
+   at FILENAME_OFFS and load the file. */
+static void EDT_FilesLoad(bool may_page)
+{
+  EDT.text_start = EDT.mem_start + VAR_END_OFFS;
+  EDT.text_end = EDT.mem_end - CUT_BUF_SIZE;
+  EDT.gap_start = EDT.text_start;
+  EDT.gap_end = EDT.text_end;
+  EDT.cut_end = EDT.text_end;
+  EDT_SyntaxSelect(EDT.mem_start+FILENAME_OFFS);
+  if (!may_page || !EDT_PageOpen(EDT.mem_start+FILENAME_OFFS))
+    EDT_LoadFile(EDT.mem_start+FILENAME_OFFS);
+  EDT_BufResetIndex();
+  EDT_UndoReset();
+  EDT.top_line = EDT.gap_start;
+  EDT.curline_len=EDT_BufLenCurLine();
+  EDT.lineno = 1;
+}
+
+/* Load the file given on the command line, EDT holds the settings. */
+void EDT_FilesInit(void)
+{
+  files_init = EDT;
+  n_files = 1;
+  cur_file = 0;
+  cut_owner = 0;
+  EDT_FilesLoad(true);
+}
+
+int EDT_FilesCount(void)
+{
+  return n_files;
+}
+
+int EDT_FilesCurrent(void)
+{
+  return cur_file;
+}
+
+/* Make file k the active one. */
+static void EDT_FilesSwitch(int k)
+{
+  files[cur_file] = EDT;
+  EDT = files[k];
+  cur_file = k;
+  EDT_BufResetIndex();
+  EDT_LexChanged(0);
+  EDT_UndoBegin();
+  EDT_InvalidateScreen();
+}
+
+/* Switch to the next file. Return false if there is only one. */
+bool EDT_FilesNext(void)
+{
+  if (n_files == 1)
+    return false;
+  EDT_FilesSwitch((cur_file + 1) % n_files);
+  return true;
+}
+
+/* The active file started a new cut, its cut buffer is the one to
+   paste. */
+void EDT_FilesOwnCut(void)
+{
+  cut_owner = cur_file;
+}
+
+/* Copy the cut buffer of the file that made the last cut to the active
+   file. If it does not fit, the active file gets an empty cut buffer. */
+void EDT_FilesTakeCut(void)
+{
+  struct _EditState *f = &files[cut_owner];
+  unsigned int n = f->cut_end - f->text_end;
+  if (cut_owner == cur_file)
+    return;
+  EDT.cut_end = EDT.text_end;
+  EDT.cut_lines = 0;
+  if (!EDT_UndoMakeRoom(n))
+    return;
+  memcpy(EDT.text_end, f->text_end, n);
+  EDT.cut_end += n;
+  EDT.cut_lines = f->cut_lines;
+  EDT.cut_block = f->cut_block;
+  cut_owner = cur_file;
+}
+
+/* Open the file name in a new buffer and make it the active file.
+   Return false if there is no room for it. */
+bool EDT_FilesOpen(unsigned char *name)
+{
+  FILE *fp;
+  long size = 0;
+  unsigned int free = EDT.gap_end - EDT.gap_start - 1;
+  unsigned int need = VAR_END_OFFS + CUT_BUF_SIZE + FILES_SLACK;
+  unsigned int give;
+  unsigned char *top = EDT.mem_end;
+  if (n_files == MAX_FILES)
+    return false;
+  fp = fopen((char*)name, "rb");
+  if (fp != NULL) {
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fclose(fp);
+  }
+  if (free < need || size < 0 || size > (long)(free - need))
+    return false;
+  need += size;
+  give = need + (free - need) / 2;
+  /* Move everything after the gap down, the top of the region of the
+     active file becomes the region of the new file. */
+  memmove(EDT.gap_end - give, EDT.gap_end, EDT.mem_end - EDT.gap_end);
+  if (EDT.top_line >= EDT.gap_end)
+    EDT.top_line -= give;
+  EDT.gap_end -= give;
+  EDT.text_end -= give;
+  EDT.cut_end -= give;
+  EDT.undo_start -= give;
+  EDT.undo_pos -= give;
+  EDT.undo_end -= give;
+  EDT.mem_end -= give;
+  files[cur_file] = EDT;
+  EDT = files_init;
+  EDT.mem_start = top - give;
+  EDT.mem_end = top;
+  strcpy((char*)EDT.mem_start+FILENAME_OFFS, (char*)name);
+  EDT.mem_start[SEARCHSTRING_OFFS]=0;
+  EDT.mem_start[REPLACESTRING_OFFS]=0;
+  cur_file = n_files++;
+  EDT_FilesLoad(false);
+  EDT_LexChanged(0);
+  EDT_UndoBegin();
+  EDT_InvalidateScreen();
+  return true;
+}
+
+/* Close the active file and give its memory to the file next to it,
+   which becomes the active file. Return false if it is the last file. */
+bool EDT_FilesClose(void)
+{
+  int k = cur_file;
+  int j;
+  unsigned int size = EDT.mem_end - EDT.mem_start;
+  unsigned char *start = EDT.mem_start;
+  if (n_files == 1)
+    return false;
+  for (j = 0; j < n_files; j++)
+    if (j != k && files[j].mem_end == start)
+      break;
+  if (j == n_files)
+    for (j = 0; j < n_files; j++)
+      if (j != k && files[j].mem_start == EDT.mem_end)
+	break;
+  EDT_FilesSwitch(j);
+  if (cut_owner == k) {
+    EDT_FilesTakeCut();
+    cut_owner = cur_file; /* Even if it did not fit */
+  }
+  if (EDT.mem_end == start) {
+    /* The region is above this one, move everything after the gap up */
+    memmove(EDT.gap_end + size, EDT.gap_end, EDT.mem_end - EDT.gap_end);
+    if (EDT.top_line >= EDT.gap_end)
+      EDT.top_line += size;
+    EDT.gap_end += size;
+    EDT.text_end += size;
+    EDT.cut_end += size;
+    EDT.undo_start += size;
+    EDT.undo_pos += size;
+    EDT.undo_end += size;
+    EDT.mem_end += size;
+  } else {
+    /* The region is below this one, move everything before the gap down */
+    memmove(EDT.mem_start - size, EDT.mem_start,
+	    EDT.gap_start - EDT.mem_start);
+    if (EDT.top_line <= EDT.gap_start)
+      EDT.top_line -= size;
+    EDT.mem_start -= size;
+    EDT.text_start -= size;
+    EDT.gap_start -= size;
+  }
+  memmove(&files[k], &files[k+1], (n_files - k - 1) * sizeof files[0]);
+  n_files--;
+  if (cur_file > k)
+    cur_file--;
+  if (cut_owner > k)
+    cut_owner--;
+  return true;
+}
@@ -0,0 +1,508 @@
+/* Nano-style editor
+   Copyright 2025, L.C. Benschop, Vught, The Netherlands.
+   MIT license
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include "edit.h"
+
+/* Paged mode, for files that do not fit in the edit buffer. The buffer
+   holds a window of whole lines of the file. The text before the window
+   is kept in the head file. The text after the window is the tail file,
+   stored byte reversed so lines moved out at the end of the window can
+   be appended to it, followed by the part of the source file that was
+   not read yet.
+
+   When the cursor gets within PAGE_MARGIN bytes of an end of the window,
+   lines are moved out at the other end and read in at this end. Search
+   and goto line move the window a whole buffer at a time. The undo
+   journal is cleared when the window moves, as its offsets are relative
+   to the window.
+*/
+#define PAGE_HEAD_NAME "/ne_head.tmp"
+#define PAGE_TAIL_NAME "/ne_tail.tmp"
+#define PAGE_CHUNK (32*1024)
+#define PAGE_MARGIN (64*1024)
+#define PAGE_RESERVE (32*1024) /* Free space left in the gap for editing */
+
+static FILE *src_fp;
+static FILE *head_fp;
+static FILE *tail_fp;
+static char src_name[MAX_NAME_LENGTH+1];
+static long src_pos;
+static long src_size;
+static long head_len;
+static long tail_len;
+static unsigned char copy_buf[512];
+
+static unsigned int EDT_PageFree(void)
+{
+  return EDT.gap_end - EDT.gap_start;
+}
+
+static bool EDT_PageTailEmpty(void)
+{
+  return tail_len == 0 && src_pos == src_size;
+}
+
+static void EDT_PageReverse(unsigned char *p, unsigned int n)
+{
+  unsigned char *q = p + n - 1;
+  unsigned char c;
+  while (p < q) {
+    c = *p;
+    *p++ = *q;
+    *q-- = c;
+  }
+}
+
+/* Move n bytes of whole lines at the start of the window, before the
+   top line of the screen, to the head file. */
+static bool EDT_PageSpillFront(unsigned int n)
+{
+  unsigned int limit = EDT.top_line - EDT.text_start;
+  unsigned int k, lines;
+  unsigned char *q;
+  if (n > limit)
+    n = limit;
+  if (n == 0)
+    return false;
+  q = EDT_MemRChr(EDT.text_start, '\n', n);
+  if (q == NULL)
+    q = memchr(EDT.text_start, '\n', limit);
+  k = q + 1 - EDT.text_start;
+  if (head_fp == NULL) {
+    head_fp = fopen(PAGE_HEAD_NAME, "w+b");
+    if (head_fp == NULL)
+      return false;
+  }
+  fseek(head_fp, head_len, SEEK_SET);
+  if (fwrite(EDT.text_start, 1, k, head_fp) != k)
+    return false;
+  head_len += k;
+  lines = EDT_BufCountLines(EDT.text_start, EDT.text_start + k);
+  memmove(EDT.text_start, EDT.text_start + k, EDT.gap_start - EDT.text_start - k);
+  EDT.gap_start -= k;
+  EDT.top_line -= k;
+  EDT.lineno -= lines;
+  EDT.total_lines -= lines;
+  EDT.lines_before += lines;
+  return true;
+}
+
+/* Move n bytes of whole lines at the end of the window to the tail file.
+   The lines that can be on the screen stay. */
+static bool EDT_PageSpillBack(unsigned int n)
+{
+  unsigned char *low = EDT.gap_end;
+  unsigned char *p;
+  unsigned int k, lines;
+  for (int i=0; i<EDT.scr_rows && low != EDT.text_end; i++)
+    low = (unsigned char *)memchr(low, '\n', EDT.text_end - low) + 1;
+  if ((unsigned int)(EDT.text_end - low) <= n) {
+    p = low;
+  } else {
+    p = EDT.text_end - n;
+    if (p[-1] != '\n')
+      p = (unsigned char *)memchr(p, '\n', n) + 1;
+    if (p == EDT.text_end) {
+      /* The last line is longer than n bytes */
+      p = EDT_MemRChr(low, '\n', EDT.text_end - 1 - low);
+      p = p ? p + 1 : low;
+    }
+  }
+  if (p == EDT.text_end)
+    return false;
+  k = EDT.text_end - p;
+  if (tail_fp == NULL) {
+    tail_fp = fopen(PAGE_TAIL_NAME, "w+b");
+    if (tail_fp == NULL)
+      return false;
+  }
+  lines = EDT_BufCountLines(p, EDT.text_end);
+  EDT_PageReverse(p, k);
+  fseek(tail_fp, tail_len, SEEK_SET);
+  if (fwrite(p, 1, k, tail_fp) != k) {
+    EDT_PageReverse(p, k);
+    return false;
+  }
+  tail_len += k;
+  memmove(EDT.gap_end + k, EDT.gap_end, p - EDT.gap_end);
+  EDT.gap_end += k;
+  EDT.total_lines -= lines;
+  EDT.lines_after += lines;
+  return true;
+}
+
+/* Read up to n bytes of whole lines from the front of the tail to buf.
+   Return the number of bytes, 0 if no whole line fits. */
+static unsigned int EDT_PageReadTail(unsigned char *buf, unsigned int n)
+{
+  unsigned int m, k;
+  unsigned char *q;
+  bool add_nl = false;
+  if (tail_len > 0) {
+    m = tail_len < n ? tail_len : n;
+    fseek(tail_fp, tail_len - m, SEEK_SET);
+    if (fread(buf, 1, m, tail_fp) != m)
+      return 0;
+    EDT_PageReverse(buf, m);
+    q = EDT_MemRChr(buf, '\n', m);
+    if (q == NULL)
+      return 0;
+    k = q + 1 - buf;
+    tail_len -= k;
+    return k;
+  }
+  fseek(src_fp, src_pos, SEEK_SET);
+  m = fread(buf, 1, n, src_fp);
+  if (m == 0)
+    return 0;
+  if (src_pos + m == src_size) {
+    k = m;
+    add_nl = buf[m-1] != '\n';
+  } else {
+    q = EDT_MemRChr(buf, '\n', m);
+    if (q == NULL)
+      return 0;
+    k = q + 1 - buf;
+  }
+  src_pos += k;
+  k = EDT_FilterText(buf, k);
+  if (add_nl)
+    buf[k++] = '\n';
+  return k;
+}
+
+/* Read up to n bytes of whole lines from the tail to the end of the
+   window, or as much as fits for a longer line. The gap holds them
+   while they are read. */
+static bool EDT_PageLoadBack(unsigned int n)
+{
+  unsigned char *buf = EDT.gap_start;
+  unsigned int max, k, lines;
+  if (EDT_PageFree() < 4)
+    return false;
+  max = (EDT_PageFree() - 2) / 2;
+  if (n > max)
+    n = max;
+  k = EDT_PageReadTail(buf, n);
+  if (k == 0 && n < max)
+    k = EDT_PageReadTail(buf, max);
+  if (k == 0)
+    return false;
+  lines = EDT_BufCountLines(buf, buf + k);
+  memmove(EDT.gap_end - k, EDT.gap_end, EDT.text_end - EDT.gap_end);
+  memmove(EDT.text_end - k, buf, k);
+  EDT.gap_end -= k;
+  EDT.total_lines += lines;
+  EDT.lines_after -= lines;
+  return true;
+}
+
+/* Read up to n bytes of whole lines from the end of the head file, into
+   the end of the gap. Return the start of the lines, NULL if no whole
+   line fits. */
+static unsigned char *EDT_PageReadHead(unsigned int n)
+{
+  unsigned int m = head_len < n ? head_len : n;
+  unsigned char *buf = EDT.gap_end - m;
+  unsigned char *p;
+  if (m == 0)
+    return NULL;
+  fseek(head_fp, head_len - m, SEEK_SET);
+  if (fread(buf, 1, m, head_fp) != m)
+    return NULL;
+  if (m == head_len)
+    return buf;
+  /* Skip the incomplete first line */
+  p = memchr(buf, '\n', m);
+  if (p == NULL || p + 1 == EDT.gap_end)
+    return NULL;
+  return p + 1;
+}
+
+/* Read up to n bytes of whole lines from the head file to the start of
+   the window, or as much as fits for a longer line. */
+static bool EDT_PageLoadFront(unsigned int n)
+{
+  unsigned char *p;
+  unsigned int max, k, lines;
+  if (EDT_PageFree() < 4)
+    return false;
+  max = (EDT_PageFree() - 2) / 2;
+  if (n > max)
+    n = max;
+  p = EDT_PageReadHead(n);
+  if (p == NULL && n < max)
+    p = EDT_PageReadHead(max);
+  if (p == NULL)
+    return false;
+  k = EDT.gap_end - p;
+  lines = EDT_BufCountLines(p, EDT.gap_end);
+  memmove(EDT.text_start + k, EDT.text_start, EDT.gap_start - EDT.text_start);
+  memmove(EDT.text_start, p, k);
+  head_len -= k;
+  EDT.gap_start += k;
+  EDT.top_line += k;
+  EDT.lineno += lines;
+  EDT.total_lines += lines;
+  EDT.lines_before -= lines;
+  return true;
+}
+
+/* The window moved, forget what depends on its addresses. */
+static void EDT_PageMoved(void)
+{
+  EDT_BufResetIndex();
+  EDT_UndoReset();
+  EDT.mark_set = 0;
+  EDT_LexChanged(0);
+}
+
+/* Open filename in paged mode if it does not fit in the buffer with
+   PAGE_RESERVE bytes to spare. Return false if it fits, or cannot
+   be opened, then it is loaded with EDT_LoadFile. */
+bool EDT_PageOpen(unsigned char *filename)
+{
+  unsigned char *buf = EDT.gap_start;
+  unsigned int n = EDT_PageFree();
+  unsigned int m;
+  unsigned char last = '\n';
+  unsigned int lines = 0;
+  src_fp = fopen((char*)filename, "rb");
+  if (src_fp == NULL)
+    return false;
+  fseek(src_fp, 0, SEEK_END);
+  src_size = ftell(src_fp);
+  if (src_size <= (long)(n - PAGE_RESERVE)) {
+    fclose(src_fp);
+    src_fp = NULL;
+    return false;
+  }
+  /* Count the lines of the whole file */
+  fseek(src_fp, 0, SEEK_SET);
+  while ((m = fread(buf, 1, n, src_fp)) > 0) {
+    lines += EDT_BufCountLines(buf, buf + m);
+    if (EDT.crlf_flag == 2 && memchr(buf, 13, m) != NULL)
+      EDT.crlf_flag = 1;
+    last = buf[m-1];
+  }
+  if (last != '\n')
+    lines++;
+  strcpy(src_name, (char*)filename);
+  src_pos = 0;
+  head_len = 0;
+  tail_len = 0;
+  EDT.paged = 1;
+  EDT.lines_before = 0;
+  EDT.lines_after = lines;
+  while (EDT_PageFree() > PAGE_RESERVE + 2*PAGE_CHUNK &&
+	 EDT_PageLoadBack(EDT_PageFree() - PAGE_RESERVE))
+    ;
+  return true;
+}
+
+/* Close and remove the temporary files. */
+void EDT_PageClose(void)
+{
+  if (!EDT.paged)
+    return;
+  fclose(src_fp);
+  if (head_fp != NULL) {
+    fclose(head_fp);
+    mos_del(PAGE_HEAD_NAME);
+  }
+  if (tail_fp != NULL) {
+    fclose(tail_fp);
+    mos_del(PAGE_TAIL_NAME);
+  }
+}
+
+/* Keep the cursor away from the ends of the window, called after each
+   command. */
+void EDT_PageCheck(void)
+{
+  bool moved = false;
+  if (!EDT.paged)
+    return;
+  while (EDT.text_end - EDT.gap_end < PAGE_MARGIN && !EDT_PageTailEmpty()) {
+    if (EDT_PageFree() < PAGE_RESERVE + 2*PAGE_CHUNK) {
+      if (!EDT_PageSpillFront(PAGE_CHUNK))
+	break;
+      moved = true;
+    }
+    /* A long line may need more room */
+    if (!EDT_PageLoadBack(PAGE_CHUNK) && !EDT_PageSpillFront(PAGE_CHUNK))
+      break;
+    moved = true;
+  }
+  while (EDT.gap_start - EDT.text_start < PAGE_MARGIN && head_len > 0) {
+    if (EDT_PageFree() < PAGE_RESERVE + 2*PAGE_CHUNK) {
+      if (!EDT_PageSpillBack(PAGE_CHUNK))
+	break;
+      moved = true;
+    }
+    if (!EDT_PageLoadFront(PAGE_CHUNK) && !EDT_PageSpillBack(PAGE_CHUNK))
+      break;
+    moved = true;
+  }
+  if (EDT_PageFree() < PAGE_RESERVE / 2) {
+    /* The text grew, make room at the side with the most text */
+    if (EDT.gap_start - EDT.text_start > EDT.text_end - EDT.gap_end)
+      moved |= EDT_PageSpillFront(PAGE_CHUNK);
+    else
+      moved |= EDT_PageSpillBack(PAGE_CHUNK);
+  }
+  if (moved)
+    EDT_PageMoved();
+}
+
+/* Put the cursor at the start of line n of the window. */
+static void EDT_PageGotoLine(unsigned int n)
+{
+  EDT.lineno = n;
+  EDT_BufGotoLine(n);
+  EDT.curline_pos = 0;
+  EDT.curline_len = EDT_BufLenCurLine();
+  EDT.cursor_col = 0;
+  EDT.cursor_col_max = 0;
+}
+
+/* Move the window forward, so it starts with its last line. The cursor
+   goes to the start of the line after it. Return false if no text was
+   read. */
+bool EDT_PageForward(void)
+{
+  unsigned int old_lines;
+  if (!EDT.paged || EDT_PageTailEmpty())
+    return false;
+  EDT_PageGotoLine(EDT.total_lines);
+  EDT.top_line = EDT.gap_start;
+  EDT.cursor_row = 0;
+  EDT_PageSpillFront(EDT.gap_start - EDT.text_start);
+  old_lines = EDT.total_lines;
+  while (EDT_PageFree() > PAGE_RESERVE + 2*PAGE_CHUNK &&
+	 EDT_PageLoadBack(EDT_PageFree() - PAGE_RESERVE))
+    ;
+  EDT_PageMoved();
+  if (EDT.total_lines == old_lines)
+    return false;
+  EDT_PageGotoLine(EDT.lineno + 1);
+  EDT.cursor_row = 1;
+  return true;
+}
+
+/* Move the window backward, so it ends with the lines on the screen
+   below its first line. The cursor goes to the start of that first line.
+   Return false if no text was read. */
+bool EDT_PageBackward(void)
+{
+  unsigned int old_lines;
+  if (!EDT.paged || head_len == 0)
+    return false;
+  EDT_PageGotoLine(1);
+  EDT.top_line = EDT.gap_start;
+  EDT.cursor_row = 0;
+  EDT_PageSpillBack(EDT.text_end - EDT.gap_end);
+  old_lines = EDT.total_lines;
+  while (EDT_PageFree() > PAGE_RESERVE + 2*PAGE_CHUNK &&
+	 EDT_PageLoadFront(EDT_PageFree() - PAGE_RESERVE))
+    ;
+  EDT_PageMoved();
+  EDT.curline_len = EDT_BufLenCurLine();
+  return EDT.total_lines != old_lines;
+}
+
+/* Make the backup of filename before it is saved. If it is the source
+   file, it is read from the backup from now on. Return false if this is
+   not possible. */
+bool EDT_PageBackup(char *filename, char *backname)
+{
+  if (strcmp(backname, src_name) == 0)
+    return false; /* It would remove the text after the window */
+  mos_del(backname);
+  if (strcmp(filename, src_name) != 0) {
+    mos_ren(filename, backname);
+    return true;
+  }
+  fclose(src_fp);
+  if (mos_ren(filename, backname) == 0)
+    strcpy(src_name, backname);
+  src_fp = fopen(src_name, "rb");
+  return src_fp != NULL && strcmp(src_name, backname) == 0;
+}
+
+/* Copy n bytes at offset pos of file f to fp. If reverse is set, the
+   bytes are read from the end of the range and reversed. */
+static bool EDT_PageCopy(FILE *fp, FILE *f, long pos, long n, bool reverse,
+			 bool filter)
+{
+  unsigned char *buf = copy_buf;
+  unsigned int size = sizeof copy_buf;
+  unsigned int m;
+  if (EDT_PageFree() > size) {
+    buf = EDT.gap_start;
+    size = EDT_PageFree();
+  }
+  while (n > 0) {
+    m = n < (long)size ? (unsigned int)n : size;
+    fseek(f, reverse ? pos + n - m : pos, SEEK_SET);
+    if (fread(buf, 1, m, f) != m)
+      return false;
+    n -= m;
+    pos += reverse ? 0 : m;
+    if (reverse)
+      EDT_PageReverse(buf, m);
+    if (!EDT_WriteText(fp, buf, filter ? EDT_FilterText(buf, m) : m))
+      return false;
+  }
+  return true;
+}
+
+/* Write the text before the window to fp. */
+bool EDT_PageWriteHead(FILE *fp)
+{
+  if (!EDT.paged)
+    return true;
+  return EDT_PageCopy(fp, head_fp, 0, head_len, false, false);
+}
+
+/* Write the text after the window to fp. */
+bool EDT_PageWriteTail(FILE *fp)
+{
+  if (!EDT.paged)
+    return true;
+  if (!EDT_PageCopy(fp, tail_fp, 0, tail_len, true, false) ||
+      !EDT_PageCopy(fp, src_fp, src_pos, src_size - src_pos, false, true))
+    return false;
+  if (src_size > src_pos) {
+    /* Add the newline that EDT_PageLoadBack would add */
+    fseek(src_fp, src_size - 1, SEEK_SET);
+    if (fgetc(src_fp) != '\n' && !EDT_WriteText(fp, (unsigned char *)"\n", 1))
+      return false;
+  }
+  return true;
+}
+
+/* The text was saved to filename, the text after the window starts at
+   offset pos. Read it from there, the old source may be removed by the
+   next save. */
+void EDT_PageSaved(char *filename, long pos)
+{
+  FILE *f;
+  if (!EDT.paged)
+    return;
+  f = fopen(filename, "rb");
+  if (f == NULL)
+    return;
+  fclose(src_fp);
+  src_fp = f;
+  strcpy(src_name, filename);
+  fseek(src_fp, 0, SEEK_END);
+  src_size = ftell(src_fp);
+  src_pos = pos;
+  tail_len = 0;
+}
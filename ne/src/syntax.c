@@ -0,0 +1,363 @@
+/* Nano-style editor
+   Copyright 2025, L.C. Benschop, Vught, The Netherlands.
+   MIT license
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdbool.h>
+#include "edit.h"
+
+/* Syntax colouring. A small lexer gives the class (HL_...) of each
+   character of a line, the screen code calls it while it renders the
+   line. Only a C comment can continue on the next line, so the state of
+   the lexer at the start of a line is a single byte, the screen code
+   keeps it for each row.
+*/
+#define LANG_NONE 0
+#define LANG_C 1
+#define LANG_ASM 2
+#define LANG_BASIC 3
+#define LANGS 4
+
+static char *lang_names[LANGS] = {"", "c", "asm", "basic"};
+
+static struct {
+  char *ext;
+  unsigned char lang;
+} lang_exts[] = {
+  {"c", LANG_C}, {"h", LANG_C},
+  {"asm", LANG_ASM}, {"inc", LANG_ASM}, {"s", LANG_ASM},
+  {"bas", LANG_BASIC}, {"bbc", LANG_BASIC},
+};
+
+static char *class_names[HL_CLASSES] = {"", "keyword", "comment", "string",
+					"number"};
+
+/* Lexer states */
+#define LEX_NORMAL 0
+#define LEX_COMMENT 1      /* In a C comment, may continue on next line */
+#define LEX_LINE_COMMENT 2 /* Comment to the end of the line */
+#define LEX_STRING 3
+
+/* Keywords from ne.cfg. Each entry in kw_buf is the language, the
+   length and the characters of the word, kw_hash holds their offsets
+   (0 for an empty slot). Assembler keywords are stored in lower case,
+   as case does not matter there. */
+#define KW_BUF_SIZE 4096
+#define KW_HASH_SIZE 512 /* Power of two */
+#define KW_MAX_LENGTH 16
+static unsigned char kw_buf[KW_BUF_SIZE];
+static unsigned int kw_used;
+static unsigned short kw_hash[KW_HASH_SIZE];
+static unsigned int kw_count;
+
+/* Lexer states at line starts, about every LEX_STEP bytes of text, so
+   the state at the top of the screen is found without lexing all the
+   text before it. The first lex_valid entries are valid. */
+#define LEX_STEP 4096
+#define LEX_MARKS (EDIT_BUF_SIZE/LEX_STEP+1)
+static unsigned int lex_offs[LEX_MARKS];
+static unsigned char lex_states[LEX_MARKS];
+static unsigned int lex_valid = 1;
+
+/* The state of the lexer within a line */
+static unsigned char lex_state;
+static unsigned char lex_quote;  /* Character that ends the string */
+static unsigned char lex_prev;   /* Previous character */
+static unsigned char lex_class;  /* Class of the rest of the token */
+static unsigned int lex_run;     /* Characters left in the token */
+static bool lex_scan;            /* Only the state matters, not classes */
+static unsigned char lex_word[KW_MAX_LENGTH];
+
+void EDT_SyntaxInit(void)
+{
+  EDT.highlight = 0;
+  EDT.syntax = LANG_NONE;
+  EDT.hl_colour[HL_KEYWORD] = 11;
+  EDT.hl_colour[HL_COMMENT] = 6;
+  EDT.hl_colour[HL_STRING] = 10;
+  EDT.hl_colour[HL_NUMBER] = 13;
+  kw_used = 1;
+  kw_count = 0;
+  memset(kw_hash, 0, sizeof kw_hash);
+}
+
+static unsigned char EDT_LangByName(char *name)
+{
+  for (unsigned char i=1; i<LANGS; i++)
+    if (strcmp(name, lang_names[i]) == 0)
+      return i;
+  return LANG_NONE;
+}
+
+static unsigned int EDT_KwHash(unsigned char lang, unsigned char *p,
+			       unsigned int n)
+{
+  unsigned int h = lang;
+  while (n-- > 0)
+    h = h * 31 + *p++;
+  return h & (KW_HASH_SIZE-1);
+}
+
+/* Return true if the n characters at p are a keyword of the language. */
+static bool EDT_IsKeyword(unsigned char lang, unsigned char *p,
+			  unsigned int n)
+{
+  unsigned int h = EDT_KwHash(lang, p, n);
+  unsigned char *e;
+  while (kw_hash[h] != 0) {
+    e = kw_buf + kw_hash[h];
+    if (e[0] == lang && e[1] == n && memcmp(e+2, p, n) == 0)
+      return true;
+    h = (h + 1) & (KW_HASH_SIZE-1);
+  }
+  return false;
+}
+
+/* Add a keyword for a language, from the line "keywords <lang> <words>"
+   in ne.cfg. */
+void EDT_SyntaxKeyword(unsigned char *lang_name, unsigned char *word)
+{
+  unsigned char lang = EDT_LangByName((char*)lang_name);
+  unsigned int n = strlen((char*)word);
+  unsigned char *e = kw_buf + kw_used;
+  unsigned int h;
+  if (lang == LANG_NONE || n > KW_MAX_LENGTH ||
+      kw_used + n + 2 > KW_BUF_SIZE || kw_count >= KW_HASH_SIZE*3/4)
+    return;
+  e[0] = lang;
+  e[1] = n;
+  for (unsigned int i=0; i<n; i++)
+    e[i+2] = lang == LANG_ASM ? tolower(word[i]) : word[i];
+  if (EDT_IsKeyword(lang, e+2, n))
+    return;
+  h = EDT_KwHash(lang, e+2, n);
+  while (kw_hash[h] != 0)
+    h = (h + 1) & (KW_HASH_SIZE-1);
+  kw_hash[h] = kw_used;
+  kw_used += n + 2;
+  kw_count++;
+}
+
+/* Set the colour of a class, from the line "colour <class> <n>" in
+   ne.cfg. */
+void EDT_SyntaxColour(unsigned char *class_name, unsigned char *colour)
+{
+  for (int i=1; i<HL_CLASSES; i++)
+    if (strcmp((char*)class_name, class_names[i]) == 0)
+      EDT.hl_colour[i] = atoi((char*)colour);
+}
+
+/* Choose the language by the extension of the file name. */
+void EDT_SyntaxSelect(unsigned char *filename)
+{
+  char *p = strrchr((char*)filename, '.');
+  char ext[4];
+  unsigned int i;
+  EDT.syntax = LANG_NONE;
+  if (!EDT.highlight || p == NULL || strlen(p+1) >= sizeof ext)
+    return;
+  for (i=0; p[i+1] != 0; i++)
+    ext[i] = tolower(p[i+1]);
+  ext[i] = 0;
+  for (i=0; i<sizeof lang_exts/sizeof lang_exts[0]; i++)
+    if (strcmp(ext, lang_exts[i].ext) == 0)
+      EDT.syntax = lang_exts[i].lang;
+  EDT_LexChanged(0);
+}
+
+/* The text changed at offset offs, forget the states after it. */
+void EDT_LexChanged(unsigned int offs)
+{
+  while (lex_valid > 1 && lex_offs[lex_valid-1] > offs)
+    lex_valid--;
+}
+
+static unsigned char *EDT_LexNext(unsigned char *p)
+{
+  p++;
+  return p == EDT.gap_start ? EDT.gap_end : p;
+}
+
+static bool EDT_LexIdStart(unsigned char c)
+{
+  return isalpha(c) || c == '_' ||
+    (c == '#' && EDT.syntax == LANG_C) ||
+    (c == '.' && EDT.syntax == LANG_ASM);
+}
+
+static bool EDT_LexIdChar(unsigned char c)
+{
+  return isalnum(c) || c == '_' ||
+    ((c == '$' || c == '%') && EDT.syntax == LANG_BASIC);
+}
+
+/* Return the length of the token at p in which each character satisfies
+   ok, the first one excepted. Keep its first characters in lex_word. */
+static unsigned int EDT_LexToken(unsigned char *p, bool (*ok)(unsigned char))
+{
+  unsigned int n = 0;
+  do {
+    if (n < KW_MAX_LENGTH)
+      lex_word[n] = EDT.syntax == LANG_ASM ? tolower(*p) : *p;
+    n++;
+    p = EDT_LexNext(p);
+  } while (ok(*p));
+  return n;
+}
+
+static bool EDT_LexNumChar(unsigned char c)
+{
+  return isalnum(c) || c == '.';
+}
+
+static bool EDT_LexHexPrefix(unsigned char c, unsigned char next)
+{
+  return isxdigit(next) &&
+    ((c == '$' && EDT.syntax == LANG_ASM) ||
+     (c == '&' && EDT.syntax == LANG_BASIC));
+}
+
+/* Start lexing a line in the given state. */
+void EDT_LexStart(unsigned char state)
+{
+  lex_state = state;
+  lex_prev = ' ';
+  lex_run = 0;
+}
+
+/* Return the state at the start of the next line. */
+unsigned char EDT_LexEnd(void)
+{
+  return lex_state == LEX_COMMENT ? LEX_COMMENT : LEX_NORMAL;
+}
+
+/* Return the class of the character at p, the next one in the line. */
+unsigned char EDT_LexChar(unsigned char *p)
+{
+  unsigned char c = *p;
+  unsigned char next;
+  unsigned char prev = lex_prev;
+  unsigned int n;
+  lex_prev = c;
+  if (lex_run > 0) {
+    /* Rest of a word, number or two character token */
+    lex_run--;
+    return lex_class;
+  }
+  switch (lex_state) {
+  case LEX_COMMENT:
+    if (c == '*' && *EDT_LexNext(p) == '/') {
+      lex_state = LEX_NORMAL;
+      lex_run = 1;
+      lex_class = HL_COMMENT;
+    }
+    return HL_COMMENT;
+  case LEX_LINE_COMMENT:
+    return HL_COMMENT;
+  case LEX_STRING:
+    if (c == '\\' && EDT.syntax == LANG_C) {
+      lex_run = 1;
+      lex_class = HL_STRING;
+    } else if (c == lex_quote) {
+      lex_state = LEX_NORMAL;
+    }
+    return HL_STRING;
+  }
+  if (EDT_LexIdStart(c)) {
+    n = EDT_LexToken(p, EDT_LexIdChar);
+    lex_run = n - 1;
+    lex_class = HL_NORMAL;
+    if (lex_scan || n > KW_MAX_LENGTH)
+      return HL_NORMAL;
+    if (EDT.syntax == LANG_BASIC && n == 3 && memcmp(lex_word, "REM", 3) == 0) {
+      lex_state = LEX_LINE_COMMENT;
+      lex_run = 0;
+      return HL_COMMENT;
+    }
+    if (EDT_IsKeyword(EDT.syntax, lex_word, n))
+      lex_class = HL_KEYWORD;
+    return lex_class;
+  }
+  if (lex_scan && c != '/' && c != '"' && c != '\'')
+    return HL_NORMAL;
+  next = *EDT_LexNext(p);
+  if (isdigit(c) || EDT_LexHexPrefix(c, next)) {
+    lex_run = EDT_LexToken(p, EDT_LexNumChar) - 1;
+    lex_class = HL_NUMBER;
+    return HL_NUMBER;
+  }
+  switch (EDT.syntax) {
+  case LANG_C:
+    if (c == '/' && next == '/') {
+      lex_state = LEX_LINE_COMMENT;
+      return HL_COMMENT;
+    }
+    if (c == '/' && next == '*') {
+      lex_state = LEX_COMMENT;
+      lex_run = 1;
+      lex_class = HL_COMMENT;
+      return HL_COMMENT;
+    }
+    break;
+  case LANG_ASM:
+    if (c == ';') {
+      lex_state = LEX_LINE_COMMENT;
+      return HL_COMMENT;
+    }
+    if (c == '\'' && EDT_LexIdChar(prev))
+      return HL_NORMAL; /* As in ex af,af' */
+    break;
+  case LANG_BASIC:
+    if (c == '\'')
+      return HL_NORMAL;
+    break;
+  }
+  if (c == '"' || c == '\'') {
+    lex_state = LEX_STRING;
+    lex_quote = c;
+    return HL_STRING;
+  }
+  return HL_NORMAL;
+}
+
+/* Return the lexer state at the start of the line at top, starting from
+   the nearest state that is known before it. */
+unsigned char EDT_LexTop(unsigned char *top)
+{
+  unsigned int offs = EDT_BufOffset(top);
+  unsigned int i = lex_valid - 1;
+  unsigned int pos;
+  unsigned char state;
+  unsigned char *p;
+  if (EDT.syntax != LANG_C)
+    return LEX_NORMAL;
+  while (lex_offs[i] > offs)
+    i--;
+  pos = lex_offs[i];
+  state = lex_states[i];
+  p = EDT_BufAddr(pos);
+  lex_scan = true;
+  EDT_LexStart(state);
+  while (pos < offs) {
+    if (*p == '\n') {
+      state = EDT_LexEnd();
+      EDT_LexStart(state);
+      if (i == lex_valid - 1 && lex_valid < LEX_MARKS &&
+	  pos + 1 >= lex_valid * LEX_STEP) {
+	lex_offs[lex_valid] = pos + 1;
+	lex_states[lex_valid] = state;
+	lex_valid++;
+	i++;
+      }
+    } else {
+      EDT_LexChar(p);
+    }
+    pos++;
+    p = EDT_LexNext(p);
+  }
+  lex_scan = false;
+  return state;
+}
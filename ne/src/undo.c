@@ -0,0 +1,252 @@
+/* Nano-style editor
+   Copyright 2025, L.C. Benschop, Vught, The Netherlands.
+   MIT license
+*/
+
+#include <string.h>
+#include <stdbool.h>
+#include "edit.h"
+
+/* Undo journal. It is stored in the free memory after the cut buffer,
+   from EDT.undo_start to EDT.undo_end. Records before EDT.undo_pos can
+   be undone, records after it can be redone. Each record is:
+
+   1 byte  flags: UNDO_DELETE for a deletion, else an insertion,
+	   UNDO_GROUP if it belongs to the same command as the record
+	   before it.
+   3 bytes text offset (see EDT_BufOffset) of the change.
+   3 bytes length n of the text.
+   n bytes the inserted or deleted text.
+   3 bytes length n again, to walk the journal backwards.
+
+   When there is no room left, the oldest commands are dropped.
+*/
+#define UNDO_DELETE 1
+#define UNDO_GROUP 2
+#define UNDO_HEAD 7
+#define UNDO_TAIL 3
+
+static bool undo_new_group = true;
+
+static unsigned int get3(unsigned char *p)
+{
+  return p[0] | (p[1] << 8) | ((unsigned int)p[2] << 16);
+}
+
+static void put3(unsigned char *p, unsigned int v)
+{
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+}
+
+static unsigned char *EDT_UndoNext(unsigned char *p)
+{
+  return p + UNDO_HEAD + get3(p+4) + UNDO_TAIL;
+}
+
+static unsigned char *EDT_UndoPrev(unsigned char *p)
+{
+  return p - UNDO_TAIL - get3(p-UNDO_TAIL) - UNDO_HEAD;
+}
+
+void EDT_UndoReset(void)
+{
+  EDT.undo_start = EDT.cut_end;
+  EDT.undo_pos = EDT.cut_end;
+  EDT.undo_end = EDT.cut_end;
+  undo_new_group = true;
+}
+
+/* Start a new command, the next change will be a separate undo step. */
+void EDT_UndoBegin(void)
+{
+  undo_new_group = true;
+}
+
+/* Move the journal to address p. */
+static void EDT_UndoSlide(unsigned char *p)
+{
+  unsigned int n = EDT.undo_end - EDT.undo_start;
+  memmove(p, EDT.undo_start, n);
+  EDT.undo_pos = p + (EDT.undo_pos - EDT.undo_start);
+  EDT.undo_start = p;
+  EDT.undo_end = p + n;
+}
+
+/* Drop the oldest command from the journal. If there is nothing left to
+   undo, drop everything that could be redone. */
+static bool EDT_UndoDropOldest(void)
+{
+  unsigned char *p = EDT.undo_start;
+  if (p == EDT.undo_end)
+    return false;
+  if (p == EDT.undo_pos) {
+    EDT.undo_end = p;
+    return true;
+  }
+  do {
+    p = EDT_UndoNext(p);
+  } while (p < EDT.undo_pos && (*p & UNDO_GROUP));
+  EDT.undo_start = p;
+  return true;
+}
+
+/* Make room for n bytes at the end of the journal. */
+static bool EDT_UndoReserve(unsigned int n)
+{
+  if ((unsigned int)(EDT.mem_end - EDT.undo_end) >= n)
+    return true;
+  for (;;) {
+    EDT_UndoSlide(EDT.cut_end);
+    if ((unsigned int)(EDT.mem_end - EDT.undo_end) >= n)
+      return true;
+    if (!EDT_UndoDropOldest())
+      return false;
+  }
+}
+
+/* Make room for n more bytes in the cut buffer. */
+bool EDT_UndoMakeRoom(unsigned int n)
+{
+  if ((unsigned int)(EDT.undo_start - EDT.cut_end) >= n)
+    return true;
+  EDT_UndoSlide(EDT.mem_end - (EDT.undo_end - EDT.undo_start));
+  while ((unsigned int)(EDT.undo_start - EDT.cut_end) < n) {
+    if (!EDT_UndoDropOldest()) {
+      EDT_UndoSlide(EDT.mem_end);
+      return (unsigned int)(EDT.mem_end - EDT.cut_end) >= n;
+    }
+  }
+  return true;
+}
+
+/* Record a change of n bytes of text at offset offs. If merge is set,
+   a single character that continues the previous insertion or deletion
+   is added to that record, so typing or deleting a run of characters is
+   undone in one step.
+*/
+void EDT_UndoRecord(bool del, unsigned int offs, unsigned char *data,
+		    unsigned int n, bool merge)
+{
+  unsigned char *p;
+  unsigned int m;
+  EDT.undo_end = EDT.undo_pos; /* A new change cannot be redone */
+  if (!EDT_UndoReserve(n + UNDO_HEAD + UNDO_TAIL)) {
+    EDT_UndoReset(); /* It does not fit at all */
+    undo_new_group = false;
+    return;
+  }
+  if (merge && n == 1 && EDT.undo_pos > EDT.undo_start) {
+    p = EDT_UndoPrev(EDT.undo_pos);
+    m = get3(p+4);
+    if (del == ((*p & UNDO_DELETE) != 0) &&
+	((!del && get3(p+1) + m == offs && p[UNDO_HEAD+m-1] != '\n') ||
+	 (del && get3(p+1) == offs) ||
+	 (del && get3(p+1) == offs + 1))) {
+      if (del && get3(p+1) == offs + 1) {
+	/* Deleted before the earlier deletion (backspace) */
+	memmove(p+UNDO_HEAD+1, p+UNDO_HEAD, m);
+	p[UNDO_HEAD] = *data;
+	put3(p+1, offs);
+      } else {
+	p[UNDO_HEAD+m] = *data;
+      }
+      put3(p+4, m+1);
+      put3(p+UNDO_HEAD+m+1, m+1);
+      EDT.undo_pos += 1;
+      EDT.undo_end = EDT.undo_pos;
+      undo_new_group = false;
+      return;
+    }
+  }
+  p = EDT.undo_pos;
+  p[0] = (del ? UNDO_DELETE : 0) | (undo_new_group ? 0 : UNDO_GROUP);
+  put3(p+1, offs);
+  put3(p+4, n);
+  memcpy(p+UNDO_HEAD, data, n);
+  put3(p+UNDO_HEAD+n, n);
+  EDT.undo_pos = p + UNDO_HEAD + n + UNDO_TAIL;
+  EDT.undo_end = EDT.undo_pos;
+  undo_new_group = false;
+}
+
+/* Insert or delete the text of record p. An insertion leaves the cursor
+   after the text, a deletion where the text was. */
+static void EDT_UndoApply(unsigned char *p, bool del)
+{
+  unsigned int n = get3(p+4);
+  unsigned int lines = EDT_BufCountLines(p+UNDO_HEAD, p+UNDO_HEAD+n);
+  EDT_BufGotoOffset(get3(p+1));
+  EDT_BufChanged();
+  if (del) {
+    EDT.gap_end += n;
+    EDT.total_lines -= lines;
+  } else {
+    memcpy(EDT.gap_start, p+UNDO_HEAD, n);
+    EDT.gap_start += n;
+    EDT.lineno += lines;
+    EDT.total_lines += lines;
+  }
+}
+
+/* Check that the text inserted while the next command is undone, or
+   redone if redo is set, fits in the gap at every step. */
+static bool EDT_UndoFits(bool redo)
+{
+  unsigned int room = EDT.gap_end - EDT.gap_start;
+  unsigned char *p = EDT.undo_pos;
+  unsigned int n;
+  do {
+    if (!redo)
+      p = EDT_UndoPrev(p);
+    n = get3(p+4);
+    if (((*p & UNDO_DELETE) != 0) != redo) {
+      if (room <= n)
+	return false;
+      room -= n;
+    } else {
+      room += n;
+    }
+    if (redo)
+      p = EDT_UndoNext(p);
+  } while (redo ? p < EDT.undo_end && (*p & UNDO_GROUP)
+	   : (*p & UNDO_GROUP) && p > EDT.undo_start);
+  return true;
+}
+
+/* Undo the last command. Return false if there is nothing to undo or
+   the text it would restore does not fit. */
+bool EDT_Undo(void)
+{
+  unsigned char *p;
+  if (EDT.undo_pos == EDT.undo_start)
+    return false;
+  if (!EDT_UndoFits(false))
+    return false;
+  do {
+    p = EDT_UndoPrev(EDT.undo_pos);
+    EDT_UndoApply(p, (*p & UNDO_DELETE) == 0);
+    EDT.undo_pos = p;
+  } while ((*p & UNDO_GROUP) && p > EDT.undo_start);
+  undo_new_group = true;
+  return true;
+}
+
+/* Redo the last undone command. Return false if there is nothing to
+   redo or the text it would insert does not fit. */
+bool EDT_Redo(void)
+{
+  unsigned char *p;
+  if (EDT.undo_pos == EDT.undo_end)
+    return false;
+  if (!EDT_UndoFits(true))
+    return false;
+  do {
+    p = EDT.undo_pos;
+    EDT_UndoApply(p, (*p & UNDO_DELETE) != 0);
+    EDT.undo_pos = EDT_UndoNext(p);
+  } while (EDT.undo_pos < EDT.undo_end && (*EDT.undo_pos & UNDO_GROUP));
+  undo_new_group = true;
+  return true;
+}
@@ -9,30 +9,9 @@
 #include <ctype.h>
 #include <stdbool.h>
 #include <mos_api.h>
+#include "../../find/src/glob.h"
 
 
-static bool glob_is_match(char *name, char *pat)
-{
-  char *p;
-  if (*name == 0 && *pat == 0) {
-    return true;
-  } else if (*pat=='?' && *name != 0) {
-    return glob_is_match(name+1, pat+1);
-  } else if (*pat=='*') {
-    p = name;
-    do {
-      if (glob_is_match(p, pat+1)) {
-	return true;
-      }
-    } while (*p++);
-    return false;
-  } else if (toupper(*pat) == toupper(*name)) {
-    return glob_is_match(name+1, pat+1);
-  } else {
-    return false;
-  }
-}
-
 bool count_lines, count_words, count_chars;
 unsigned long lines,words,chars, total_lines, total_words, total_chars;
 
@@ -125,6 +104,7 @@ main(int argc, char *argv[])
     count_chars = true;
   }
   for (; nopts<argc-1; nopts++) {
+    glob_prepare(argv[1+nopts]);
     res = ffs_dopen(&dir_struct,".");
     if (res == 0) {
       for (;;) {